@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <catch2/catch.hpp>
+#include <taskgraph/TaskGraph.h>
+#include <taskgraph/utils.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Hardware cache miss counter of the calling thread, reads zero where perf events aren't available.
+    class PerfCounter {
+    private:
+        int fd = -1;
+
+    public:
+        PerfCounter(uint32_t type, uint64_t config) {
+#if defined(__linux__)
+            perf_event_attr attr {};
+            attr.type = type;
+            attr.size = sizeof(attr);
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+        }
+
+        ~PerfCounter() {
+#if defined(__linux__)
+            if (fd >= 0) {
+                close(fd);
+            }
+#endif
+        }
+
+        [[nodiscard]] bool available() const {
+            return fd >= 0;
+        }
+
+        void start() {
+#if defined(__linux__)
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        uint64_t stop() {
+            uint64_t count = 0;
+#if defined(__linux__)
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                    count = 0;
+                }
+            }
+#endif
+            return count;
+        }
+    };
+
+    // Pool item layout `PoolAllocator` used to have, with the free list link and version in front of the data.
+    struct InlineHeaderItem {
+        void* next = nullptr;
+        std::atomic<uint64_t> version = 0u;
+        std::array<uint8_t, sizeof(Task)> itemData {};
+    };
+
+    struct LayoutResult {
+        double nsPerItem;
+        double l1MissesPerItem;
+        double llcMissesPerItem;
+        bool countersAvailable;
+    };
+
+    // Visits items in random order the way a worker runs tasks: the task is read from its first to its last byte
+    // and, with `touchVersion`, the handle's version is validated beforehand and bumped by releasing the task.
+    template<typename GetVersion, typename GetData>
+    LayoutResult visitItems(size_t itemCount, bool touchVersion, GetVersion&& getVersion, GetData&& getData) {
+        static constexpr size_t ROUNDS = 10;
+
+        std::vector<uint32_t> order(itemCount);
+        for (auto i = 0u; i < itemCount; i++) {
+            order[i] = i;
+        }
+
+        std::shuffle(order.begin(), order.end(), std::mt19937 { 42 });
+
+#if defined(__linux__)
+        PerfCounter l1Misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8u)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16u));
+        PerfCounter llcMisses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#else
+        PerfCounter l1Misses(0, 0);
+        PerfCounter llcMisses(0, 0);
+#endif
+
+        volatile uint64_t sink = 0;
+        l1Misses.start();
+        llcMisses.start();
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto round = 0u; round < ROUNDS; round++) {
+            for (auto i : order) {
+                if (!touchVersion) {
+                    auto* data = getData(i);
+                    sink = sink + data[0] + data[sizeof(Task) - 1];
+                    continue;
+                }
+
+                auto& version = getVersion(i);
+                if (version.load(std::memory_order_relaxed) == round) {
+                    auto* data = getData(i);
+                    sink = sink + data[0] + data[sizeof(Task) - 1];
+                }
+
+                version.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        auto l1 = (double)l1Misses.stop();
+        auto llc = (double)llcMisses.stop();
+        auto visits = (double)(ROUNDS * itemCount);
+
+        return { elapsed / visits, l1 / visits, llc / visits, l1Misses.available() && llcMisses.available() };
+    }
+    // Free list guarded by a mutex, kept as a baseline for the lock-free tagged free list.
+    template<typename T>
+    class MutexPoolAllocator {
+    private:
+        std::vector<PoolItem<T>> items;
+        std::vector<PoolItem<T>*> freeItems;
+        std::mutex mutex;
+
+    public:
+        explicit MutexPoolAllocator(size_t inSize)
+            :items { inSize } {
+            for (auto& item : items) {
+                freeItems.push_back(&item);
+            }
+        }
+
+        PoolItem<T>* obtain() {
+            std::lock_guard lock { mutex };
+            if (freeItems.empty()) {
+                return nullptr;
+            }
+
+            auto* item = freeItems.back();
+            freeItems.pop_back();
+            new(item->data())T();
+
+            return item;
+        }
+
+        void release(PoolItem<T>* item) {
+            item->data()->~T();
+
+            std::lock_guard lock { mutex };
+            freeItems.push_back(item);
+        }
+    };
+
+    // Every thread repeatedly obtains a batch of tasks and releases them, like workers spawning and finishing
+    // subtasks through the shared pool.
+    template<typename P>
+    double contended(size_t threadCount, size_t batchSize) {
+        static constexpr size_t ROUNDS = 20000;
+
+        P pool(threadCount * batchSize);
+        std::atomic<bool> go { false };
+        std::vector<std::thread> threads;
+
+        for (auto t = 0u; t < threadCount; t++) {
+            threads.emplace_back([&]() {
+                std::vector<PoolItem<Task>*> batch;
+                batch.reserve(batchSize);
+
+                while (!go) {
+                    std::this_thread::yield();
+                }
+
+                for (auto round = 0u; round < ROUNDS; round++) {
+                    for (auto i = 0u; i < batchSize; i++) {
+                        if (auto* item = pool.obtain()) {
+                            batch.push_back(item);
+                        }
+                    }
+
+                    for (auto* item : batch) {
+                        pool.release(item);
+                    }
+
+                    batch.clear();
+                }
+            });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        go = true;
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return (double)(threadCount * ROUNDS * batchSize) / elapsed;
+    }
+
+    // One thread obtains tasks like a worker spawning subtasks, releases `localShare` of them itself and hands the
+    // rest to `thiefCount` threads releasing them, like thieves finishing stolen tasks. Returns the obtained items
+    // per second, with the pool either owned by the spawning thread or shared.
+    double spawnHeavy(size_t thiefCount, double localShare, bool owned) {
+        static constexpr size_t ITEM_COUNT = 2000000;
+        static constexpr size_t SLAB_SIZE = 4096;
+
+        PoolAllocator<Task> pool(SLAB_SIZE);
+        if (owned) {
+            pool.setOwner(std::this_thread::get_id());
+        }
+
+        InjectionQueue handOff;
+        std::atomic<bool> done { false };
+        std::vector<std::thread> thieves;
+
+        for (auto i = 0u; i < thiefCount; i++) {
+            thieves.emplace_back([&]() {
+                while (true) {
+                    if (auto* task = handOff.pop()) {
+                        pool.release(PoolItem<Task>::fromData(task));
+                    } else if (done) {
+                        break;
+                    }
+                }
+            });
+        }
+
+        auto localEvery = localShare > 0.0 ? (size_t)(1.0 / localShare) : ITEM_COUNT + 1;
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto i = 0u; i < ITEM_COUNT; i++) {
+            auto* item = pool.obtain();
+            if (i % localEvery == 0 || !handOff.push(item->data())) {
+                pool.release(item);
+            }
+        }
+
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        done = true;
+
+        for (auto& thief : thieves) {
+            thief.join();
+        }
+
+        return (double)ITEM_COUNT / elapsed;
+    }
+}
+
+TEST_CASE("Contended obtain & release", "[PoolAllocator][benchmark]") {
+    static constexpr size_t BATCH_SIZE = 8;
+
+    auto maxThreads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (auto threads = 1u; threads <= maxThreads; threads *= 2) {
+        utils::print("threads: ", threads,
+            ", mutex: ", contended<MutexPoolAllocator<Task>>(threads, BATCH_SIZE), " items/s",
+            ", tagged lock-free: ", contended<PoolAllocator<Task>>(threads, BATCH_SIZE), " items/s");
+    }
+}
+
+TEST_CASE("Owner-local free list", "[PoolAllocator][benchmark]") {
+    auto maxThieves = std::max(1u, std::thread::hardware_concurrency() - 1);
+
+    for (auto localShare : { 1.0, 0.5, 0.1 }) {
+        for (auto thieves = 1u; thieves <= maxThieves; thieves *= 2) {
+            utils::print("released locally: ", localShare * 100.0, "%, thieves: ", thieves,
+                ", shared: ", spawnHeavy(thieves, localShare, false), " items/s",
+                ", owned: ", spawnHeavy(thieves, localShare, true), " items/s");
+        }
+    }
+}
+
+TEST_CASE("Item layout", "[PoolAllocator][benchmark]") {
+    static constexpr size_t SLAB_SIZE = 4096;
+
+    for (auto itemCount : { 16u * 1024u, 256u * 1024u }) {
+        // Both layouts are reached through pointers, the way tasks are reached through queues.
+        std::vector<InlineHeaderItem> inlineStorage(itemCount);
+        std::vector<InlineHeaderItem*> inlineItems;
+        for (auto& item : inlineStorage) {
+            inlineItems.push_back(&item);
+        }
+
+        PoolAllocator<Task> pool(SLAB_SIZE);
+        std::vector<PoolItem<Task>*> items;
+        for (auto i = 0u; i < itemCount; i++) {
+            items.push_back(pool.obtain());
+        }
+
+        for (auto touchVersion : { false, true }) {
+            auto inlineResult = visitItems(itemCount, touchVersion, [&](uint32_t i) -> std::atomic<uint64_t>& {
+                return inlineItems[i]->version;
+            }, [&](uint32_t i) {
+                return inlineItems[i]->itemData.data();
+            });
+
+            auto pooledResult = visitItems(itemCount, touchVersion, [&](uint32_t i) -> std::atomic<uint64_t>& {
+                return items[i]->meta().version;
+            }, [&](uint32_t i) {
+                return (uint8_t*)items[i]->data();
+            });
+
+            if (!inlineResult.countersAvailable) {
+                utils::print("perf events are unavailable, only timing items");
+            }
+
+            auto* access = touchVersion ? "task and version" : "task only";
+            utils::print(itemCount, " items, ", access, ", inline header (", sizeof(InlineHeaderItem), " bytes): ",
+                inlineResult.nsPerItem, " ns, ", inlineResult.l1MissesPerItem, " L1D misses, ",
+                inlineResult.llcMissesPerItem, " LLC misses per item");
+            utils::print(itemCount, " items, ", access, ", out-of-band header (", sizeof(PoolItem<Task>),
+                " bytes): ", pooledResult.nsPerItem, " ns, ", pooledResult.l1MissesPerItem, " L1D misses, ",
+                pooledResult.llcMissesPerItem, " LLC misses per item");
+        }
+    }
+}
@@ -0,0 +1,380 @@
+#include <array>
+#include <thread>
+#include <chrono>
+#include <catch2/catch.hpp>
+#include <taskgraph/TaskGraph.h>
+#include <taskgraph/utils.h>
+
+namespace {
+    // The fixed 4096-slot ring `TaskQueue` used to be, kept as a baseline for comparison.
+    class FixedTaskQueue {
+    private:
+        static constexpr uint32_t MAX_TASK_COUNT = 4096u;
+        static constexpr uint32_t TASK_LOOKUP_MASK = MAX_TASK_COUNT - 1u;
+
+        std::array<Task*, MAX_TASK_COUNT> tasks;
+        std::atomic<int> top;
+        std::atomic<int> bottom;
+
+    public:
+        FixedTaskQueue()
+            :tasks { nullptr }, top { 0 }, bottom { 0 } { }
+
+        void push(Task* task) {
+            int b = bottom;
+            tasks[b & TASK_LOOKUP_MASK] = task;
+            bottom = b + 1;
+        }
+
+        Task* pop() {
+            int b = std::max(0, bottom - 1);
+            bottom = b;
+            int t = top;
+
+            if (t <= b) {
+                auto* task = tasks[b & TASK_LOOKUP_MASK];
+                if (t != b) {
+                    return task;
+                }
+
+                if (!top.compare_exchange_strong(t, t + 1)) {
+                    task = nullptr;
+                }
+
+                bottom = t + 1;
+                return task;
+            }
+
+            bottom = t;
+            return nullptr;
+        }
+
+        Task* steal() {
+            int t = top;
+            int b = bottom;
+            if (t < b) {
+                auto* task = tasks[t & TASK_LOOKUP_MASK];
+                if (!top.compare_exchange_strong(t, t + 1)) {
+                    return nullptr;
+                }
+
+                return task;
+            }
+
+            return nullptr;
+        }
+    };
+
+    // The growable deque with sequentially consistent atomics everywhere, kept as a baseline for the
+    // relaxed/acquire/release ordering `TaskQueue` uses.
+    class SeqCstTaskQueue {
+    private:
+        struct Buffer {
+            int64_t capacity;
+            int64_t mask;
+            std::unique_ptr<std::atomic<Task*>[]> tasks;
+
+            explicit Buffer(int64_t inCapacity)
+                :capacity { inCapacity }, mask { inCapacity - 1 }, tasks { new std::atomic<Task*>[inCapacity] } {
+            }
+        };
+
+        std::atomic<int64_t> top;
+        std::atomic<int64_t> bottom;
+        std::atomic<Buffer*> buffer;
+        std::vector<std::unique_ptr<Buffer>> buffers;
+
+    public:
+        SeqCstTaskQueue()
+            :top { 0 }, bottom { 0 } {
+            buffers.push_back(std::make_unique<Buffer>(4096));
+            buffer = buffers.back().get();
+        }
+
+        void push(Task* task) {
+            int64_t b = bottom;
+            int64_t t = top;
+            Buffer* buf = buffer;
+
+            if (b - t > buf->capacity - 1) {
+                buffers.push_back(std::make_unique<Buffer>(buf->capacity * 2));
+                for (auto i = t; i < b; i++) {
+                    buffers.back()->tasks[i & buffers.back()->mask] = buf->tasks[i & buf->mask].load();
+                }
+                buf = buffers.back().get();
+                buffer = buf;
+            }
+
+            buf->tasks[b & buf->mask] = task;
+            bottom = b + 1;
+        }
+
+        Task* pop() {
+            int64_t b = bottom - 1;
+            Buffer* buf = buffer;
+            bottom = b;
+            int64_t t = top;
+
+            if (t <= b) {
+                Task* task = buf->tasks[b & buf->mask];
+                if (t != b) {
+                    return task;
+                }
+
+                if (!top.compare_exchange_strong(t, t + 1)) {
+                    task = nullptr;
+                }
+
+                bottom = b + 1;
+                return task;
+            }
+
+            bottom = b + 1;
+            return nullptr;
+        }
+
+        Task* steal() {
+            int64_t t = top;
+            int64_t b = bottom;
+
+            if (t < b) {
+                Buffer* buf = buffer;
+                Task* task = buf->tasks[t & buf->mask];
+                if (!top.compare_exchange_strong(t, t + 1)) {
+                    return nullptr;
+                }
+
+                return task;
+            }
+
+            return nullptr;
+        }
+    };
+
+    constexpr size_t BATCH_SIZE = 1024;
+
+    template<typename Q>
+    size_t pushPop(Q& queue, std::vector<Task>& tasks) {
+        size_t count = 0;
+
+        for (auto& task : tasks) {
+            queue.push(&task);
+        }
+
+        while (queue.pop() != nullptr) {
+            count++;
+        }
+
+        return count;
+    }
+
+    template<typename Q>
+    size_t pushSteal(Q& queue, std::vector<Task>& tasks) {
+        size_t count = 0;
+
+        for (auto& task : tasks) {
+            queue.push(&task);
+        }
+
+        while (queue.steal() != nullptr) {
+            count++;
+        }
+
+        return count;
+    }
+
+    // Owner pushes batches of tasks and pops them back while `thiefCount` threads steal from the same queue.
+    // Returns the number of transferred tasks per second.
+    template<typename Q>
+    double contended(size_t thiefCount, size_t batchSize) {
+        static constexpr size_t ROUNDS = 2000;
+
+        Q queue;
+        std::vector<Task> tasks { batchSize };
+        std::atomic<bool> done { false };
+        std::atomic<size_t> stolen { 0 };
+        std::vector<std::thread> thieves;
+
+        for (auto i = 0u; i < thiefCount; i++) {
+            thieves.emplace_back([&]() {
+                size_t count = 0;
+                while (!done) {
+                    if (queue.steal() != nullptr) {
+                        count++;
+                    }
+                }
+                stolen += count;
+            });
+        }
+
+        size_t popped = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto round = 0u; round < ROUNDS; round++) {
+            for (auto& task : tasks) {
+                queue.push(&task);
+            }
+
+            while (queue.pop() != nullptr) {
+                popped++;
+            }
+        }
+
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        done = true;
+
+        for (auto& thief : thieves) {
+            thief.join();
+        }
+
+        return (double)(popped + stolen) / elapsed;
+    }
+
+    void spin(size_t iterations) {
+        // Going through a volatile keeps the loop from being optimized away.
+        volatile size_t sink = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            sink = sink + 1;
+        }
+    }
+
+    struct FanOutTimes {
+        double rampUp;
+        double total;
+    };
+
+    // The victim's queue is filled with `taskCount` tasks, which `thiefCount` threads drain either one steal
+    // at a time or by stealing batches into their own queue. Returns the time until every thief started
+    // executing tasks, and the time until all tasks have executed.
+    FanOutTimes fanOut(size_t thiefCount, size_t taskCount, bool batch) {
+        static constexpr size_t TASK_WORK = 2000;
+
+        TaskQueue victim;
+        std::vector<Task> tasks { taskCount };
+        std::atomic<size_t> executed { 0 };
+        std::atomic<size_t> started { 0 };
+        std::atomic<bool> go { false };
+        std::vector<std::thread> thieves;
+
+        using Clock = std::chrono::steady_clock;
+        std::atomic<Clock::rep> rampUpEnd { 0 };
+
+        for (auto& task : tasks) {
+            victim.push(&task);
+        }
+
+        for (auto i = 0u; i < thiefCount; i++) {
+            thieves.emplace_back([&]() {
+                TaskQueue local;
+                bool first = true;
+
+                while (!go) { }
+
+                while (executed < taskCount) {
+                    auto* task = batch ? victim.stealBatch(local) : victim.steal();
+                    while (task != nullptr) {
+                        if (first) {
+                            first = false;
+                            if (++started == thiefCount) {
+                                rampUpEnd = Clock::now().time_since_epoch().count();
+                            }
+                        }
+
+                        spin(TASK_WORK);
+                        executed++;
+                        task = local.pop();
+                    }
+                }
+            });
+        }
+
+        auto start = Clock::now();
+        go = true;
+
+        for (auto& thief : thieves) {
+            thief.join();
+        }
+
+        auto end = Clock::now();
+        auto rampUp = Clock::time_point(Clock::duration(rampUpEnd.load())) - start;
+
+        return {
+            std::chrono::duration<double, std::micro>(rampUp).count(),
+            std::chrono::duration<double, std::micro>(end - start).count()
+        };
+    }
+}
+
+TEST_CASE("Push & pop", "[TaskQueue][benchmark]") {
+    std::vector<Task> tasks { BATCH_SIZE };
+
+    BENCHMARK("Fixed ring") {
+        FixedTaskQueue queue;
+        return pushPop(queue, tasks);
+    };
+
+    BENCHMARK("Growable, seq_cst") {
+        SeqCstTaskQueue queue;
+        return pushPop(queue, tasks);
+    };
+
+    BENCHMARK("Growable") {
+        TaskQueue queue;
+        return pushPop(queue, tasks);
+    };
+}
+
+TEST_CASE("Push & steal", "[TaskQueue][benchmark]") {
+    std::vector<Task> tasks { BATCH_SIZE };
+
+    BENCHMARK("Fixed ring") {
+        FixedTaskQueue queue;
+        return pushSteal(queue, tasks);
+    };
+
+    BENCHMARK("Growable, seq_cst") {
+        SeqCstTaskQueue queue;
+        return pushSteal(queue, tasks);
+    };
+
+    BENCHMARK("Growable") {
+        TaskQueue queue;
+        return pushSteal(queue, tasks);
+    };
+}
+
+TEST_CASE("Growth", "[TaskQueue][benchmark]") {
+    // Exceeds the fixed ring capacity, so there's no baseline for it.
+    std::vector<Task> tasks { 64 * 1024 };
+
+    BENCHMARK("Growable, 64k tasks") {
+        TaskQueue queue;
+        return pushPop(queue, tasks);
+    };
+}
+
+TEST_CASE("Contended throughput", "[TaskQueue][benchmark]") {
+    auto maxThieves = std::max(1u, std::thread::hardware_concurrency() - 1);
+
+    for (auto thieves = 1u; thieves <= maxThieves; thieves *= 2) {
+        utils::print("thieves: ", thieves,
+            ", fixed ring: ", contended<FixedTaskQueue>(thieves, BATCH_SIZE), " tasks/s",
+            ", growable seq_cst: ", contended<SeqCstTaskQueue>(thieves, BATCH_SIZE), " tasks/s",
+            ", growable: ", contended<TaskQueue>(thieves, BATCH_SIZE), " tasks/s");
+    }
+}
+
+TEST_CASE("Fan-out ramp-up", "[TaskQueue][benchmark]") {
+    static constexpr size_t TASK_COUNT = 20000;
+
+    auto maxThieves = std::max(1u, std::thread::hardware_concurrency() - 1);
+
+    for (auto thieves = 1u; thieves <= maxThieves; thieves *= 2) {
+        auto single = fanOut(thieves, TASK_COUNT, false);
+        auto batch = fanOut(thieves, TASK_COUNT, true);
+
+        utils::print("thieves: ", thieves,
+            ", steal: ramp-up ", single.rampUp, " us, total ", single.total, " us",
+            ", steal batch: ramp-up ", batch.rampUp, " us, total ", batch.total, " us");
+    }
+}
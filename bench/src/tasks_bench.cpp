@@ -0,0 +1,800 @@
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include <tasks.h>
+#include <taskgraph/utils.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    void spin(uint32_t iterations) {
+        // Going through a volatile keeps the loop from being optimized away.
+        volatile uint32_t sink = 0;
+        for (auto i = 0u; i < iterations; i++) {
+            sink = sink + 1;
+        }
+    }
+
+    void spawnTree(Task& parent, uint32_t depth) {
+        if (depth == 0) {
+            spin(500u);
+            return;
+        }
+
+        for (auto i = 0u; i < 2u; i++) {
+            tasks::add(parent, [depth](auto& task) {
+                spawnTree(task, depth - 1);
+            });
+        }
+    }
+
+    template<typename T>
+    size_t taskLineCount(const T&) {
+        return sizeof(TaskClassFor<T>) / std::hardware_destructive_interference_size;
+    }
+
+    double percentile(std::vector<double>& samples, double p) {
+        std::sort(samples.begin(), samples.end());
+        auto idx = std::min(samples.size() - 1, (size_t)(p * (double)samples.size()));
+        return samples[idx];
+    }
+}
+
+TEST_CASE("Cross-thread submit latency", "[tasks][benchmark]") {
+    static constexpr size_t SAMPLE_COUNT = 10000;
+
+    tasks::init(std::max(2u, std::thread::hardware_concurrency()));
+
+    std::vector<double> samples;
+    samples.reserve(SAMPLE_COUNT);
+
+    // Measure from a thread which isn't a worker: time from `tasks::add` returning to the task starting.
+    std::thread submitter([&]() {
+        for (auto i = 0u; i < SAMPLE_COUNT; i++) {
+            std::atomic<Clock::rep> started { 0 };
+
+            auto submitted = Clock::now();
+            auto task = tasks::add([&](auto&) {
+                started = Clock::now().time_since_epoch().count();
+            });
+
+            tasks::wait(task);
+
+            auto latency = Clock::time_point(Clock::duration(started.load())) - submitted;
+            samples.push_back(std::chrono::duration<double, std::micro>(latency).count());
+        }
+    });
+
+    submitter.join();
+    tasks::shutdown();
+
+    utils::print("submit latency: p50 ", percentile(samples, 0.5), " us, p99 ", percentile(samples, 0.99),
+        " us, max ", percentile(samples, 1.0), " us");
+}
+
+TEST_CASE("Priority latency under load", "[tasks][benchmark]") {
+    static constexpr size_t BACKGROUND_TASK_COUNT = 4000;
+    static constexpr size_t SAMPLE_COUNT = 500;
+
+    auto measure = [](tasks::Priority probePriority) {
+        std::vector<double> samples;
+        samples.reserve(SAMPLE_COUNT);
+        std::atomic<bool> done { false };
+
+        tasks::init(std::max(2u, std::thread::hardware_concurrency()));
+
+        // Saturate workers with low priority tasks, replenishing them as they complete.
+        std::thread loader([&]() {
+            while (!done) {
+                auto root = tasks::add(tasks::Priority::Low, [](auto& task) {
+                    for (auto i = 0u; i < BACKGROUND_TASK_COUNT; i++) {
+                        tasks::add(task, [](auto&) {
+                            auto until = Clock::now() + std::chrono::microseconds(20);
+                            while (Clock::now() < until) { }
+                        });
+                    }
+                });
+
+                tasks::wait(root);
+            }
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        for (auto i = 0u; i < SAMPLE_COUNT; i++) {
+            std::atomic<Clock::rep> started { 0 };
+
+            auto submitted = Clock::now();
+            auto task = tasks::add(probePriority, [&](auto&) {
+                started = Clock::now().time_since_epoch().count();
+            });
+
+            while (task.valid()) {
+                std::this_thread::yield();
+            }
+
+            auto latency = Clock::time_point(Clock::duration(started.load())) - submitted;
+            samples.push_back(std::chrono::duration<double, std::micro>(latency).count());
+        }
+
+        done = true;
+        loader.join();
+        tasks::shutdown();
+
+        return std::make_pair(percentile(samples, 0.5), percentile(samples, 0.99));
+    };
+
+    auto high = measure(tasks::Priority::High);
+    auto low = measure(tasks::Priority::Low);
+
+    utils::print("high priority probe: p50 ", high.first, " us, p99 ", high.second, " us");
+    utils::print("low priority probe: p50 ", low.first, " us, p99 ", low.second, " us");
+}
+
+TEST_CASE("Victim policies", "[tasks][benchmark]") {
+    static constexpr uint32_t TREE_DEPTH = 16;
+    static constexpr size_t RUN_COUNT = 5;
+
+    std::vector<std::pair<const char*, VictimPolicy>> policies = {
+        { "linear", VictimPolicy::Linear },
+        { "random", VictimPolicy::Random },
+        { "hierarchical", VictimPolicy::Hierarchical }
+    };
+
+    for (auto& [name, policy] : policies) {
+        tasks::Options options;
+        options.victimPolicy = policy;
+        tasks::init(options);
+
+        // Recursive binary fan-out, every task spawns two subtasks until the leaves do some work.
+        double best = std::numeric_limits<double>::max();
+        for (auto run = 0u; run < RUN_COUNT; run++) {
+            auto start = Clock::now();
+            auto task = tasks::add([](auto& task) {
+                spawnTree(task, TREE_DEPTH);
+            });
+
+            tasks::wait(task);
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        tasks::shutdown();
+        utils::print(name, ": ", best, " ms for ", 1u << TREE_DEPTH, " leaves on ", options.numThreads, " workers");
+    }
+}
+
+TEST_CASE("Idle strategy", "[tasks][benchmark]") {
+    static constexpr size_t SAMPLE_COUNT = 200;
+
+    std::vector<std::pair<const char*, Worker::IdlePolicy>> policies = {
+        { "spin", Worker::IdlePolicy::Spin },
+        { "park", Worker::IdlePolicy::Park }
+    };
+
+    for (auto& [name, policy] : policies) {
+        tasks::Options options;
+        options.numThreads = std::max(2u, std::thread::hardware_concurrency());
+        options.idlePolicy = policy;
+        tasks::init(options);
+
+        // CPU time burnt by the process while the graph is empty, in cores.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        auto cpuStart = std::clock();
+        auto wallStart = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        auto cpuTime = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        auto wallTime = std::chrono::duration<double>(Clock::now() - wallStart).count();
+
+        // Time for an idle background worker to pick up a task submitted from the foreground thread, which
+        // doesn't execute tasks unless it's waiting.
+        std::vector<double> samples;
+        for (auto i = 0u; i < SAMPLE_COUNT; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+            std::atomic<Clock::rep> started { 0 };
+            auto submitted = Clock::now();
+            tasks::add([&](auto&) {
+                started = Clock::now().time_since_epoch().count();
+            });
+
+            while (started == 0) {
+                std::this_thread::yield();
+            }
+
+            auto latency = Clock::time_point(Clock::duration(started.load())) - submitted;
+            samples.push_back(std::chrono::duration<double, std::micro>(latency).count());
+        }
+
+        tasks::shutdown();
+
+        utils::print(name, ": idle CPU ", cpuTime / wallTime, " cores, wake latency p50 ", percentile(samples, 0.5),
+            " us, p99 ", percentile(samples, 0.99), " us");
+    }
+}
+
+TEST_CASE("Bounded searching", "[tasks][benchmark]") {
+    static constexpr size_t CHAIN_LENGTH = 20000;
+    static constexpr size_t CHAIN_COUNT = 2;
+
+    auto numThreads = std::max(4u, std::thread::hardware_concurrency());
+    std::vector<std::pair<const char*, uint32_t>> limits = {
+        { "unbounded", numThreads },
+        { "half", 0 }
+    };
+
+    for (auto& [name, limit] : limits) {
+        tasks::Options options;
+        options.numThreads = numThreads;
+        options.maxSearchingWorkers = limit;
+        tasks::init(options);
+
+        // Only a couple of tasks are runnable at any time, the rest of the workers have nothing to do but steal.
+        std::atomic<size_t> remaining { CHAIN_LENGTH * CHAIN_COUNT };
+        std::function<void()> step = [&]() {
+            if (--remaining >= CHAIN_COUNT) {
+                tasks::add([&](auto&) {
+                    step();
+                });
+            }
+        };
+
+        auto start = Clock::now();
+        auto cpuStart = std::clock();
+        for (auto i = 0u; i < CHAIN_COUNT; i++) {
+            tasks::add([&](auto&) {
+                step();
+            });
+        }
+
+        while (remaining != 0) {
+            std::this_thread::yield();
+        }
+
+        auto wallTime = std::chrono::duration<double>(Clock::now() - start).count();
+        auto cpuTime = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+        tasks::shutdown();
+
+        utils::print(name, ": ", (double)(CHAIN_LENGTH * CHAIN_COUNT) / wallTime / 1000.0, " ktasks/s, ",
+            cpuTime / wallTime, " cores busy on ", numThreads, " workers");
+    }
+}
+
+TEST_CASE("Spawn cost", "[tasks][benchmark]") {
+    static constexpr size_t TASK_COUNT = 200000;
+    static constexpr size_t RUN_COUNT = 5;
+
+    // A single worker spawns and runs every task, so only the cost of creating, running and releasing them is
+    // measured.
+    tasks::init(1);
+
+    auto measure = [](auto makeTask) {
+        double best = std::numeric_limits<double>::max();
+        for (auto run = 0u; run < RUN_COUNT; run++) {
+            auto start = Clock::now();
+            auto root = tasks::add([&](auto& task) {
+                for (auto i = 0u; i < TASK_COUNT; i++) {
+                    makeTask(task, i);
+                }
+            });
+
+            tasks::wait(root);
+            best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+        }
+
+        return best / TASK_COUNT;
+    };
+
+    std::atomic<size_t> sink { 0 };
+    auto shared = std::make_shared<size_t>(1);
+    size_t lineCounts[3] = {};
+
+    auto pointerCapture = measure([&](Task& parent, uint32_t) {
+        auto taskFn = [&sink](auto&) {
+            sink.fetch_add(1, std::memory_order_relaxed);
+        };
+
+        lineCounts[0] = taskLineCount(taskFn);
+        tasks::add(parent, std::move(taskFn));
+    });
+
+    auto sharedCapture = measure([&](Task& parent, uint32_t) {
+        auto taskFn = [&sink, shared](auto&) {
+            sink.fetch_add(*shared, std::memory_order_relaxed);
+        };
+
+        lineCounts[1] = taskLineCount(taskFn);
+        tasks::add(parent, std::move(taskFn));
+    });
+
+    auto indexedCapture = measure([&](Task& parent, uint32_t i) {
+        auto taskFn = [&sink, shared, i](auto&) {
+            sink.fetch_add(*shared + i, std::memory_order_relaxed);
+        };
+
+        lineCounts[2] = taskLineCount(taskFn);
+        tasks::add(parent, std::move(taskFn));
+    });
+
+    tasks::shutdown();
+
+    utils::print("8 byte capture: ", pointerCapture, " ns/task, ", lineCounts[0], " line task");
+    utils::print("24 byte capture: ", sharedCapture, " ns/task, ", lineCounts[1], " line task");
+    utils::print("32 byte capture: ", indexedCapture, " ns/task, ", lineCounts[2], " line task");
+}
+
+TEST_CASE("Recorded graph", "[tasks][benchmark]") {
+    static constexpr size_t LAYER_COUNT = 20;
+    static constexpr size_t LAYER_SIZE = 100;
+    static constexpr size_t FRAME_COUNT = 200;
+
+    tasks::init(std::max(2u, std::thread::hardware_concurrency()));
+
+    // A frame of 2000 tasks in layers, each task depending on two tasks of the previous layer.
+    std::atomic<size_t> sink { 0 };
+    auto work = [&sink](size_t i) {
+        spin(50u);
+        sink.fetch_add(i, std::memory_order_relaxed);
+    };
+
+    auto rebuilt = [&]() {
+        std::vector<tasks::TaskHandle> nodes;
+        nodes.reserve(LAYER_COUNT * LAYER_SIZE);
+
+        for (auto layer = 0u; layer < LAYER_COUNT; layer++) {
+            for (auto i = 0u; i < LAYER_SIZE; i++) {
+                nodes.push_back(tasks::create([&work, i](auto&) {
+                    work(i);
+                }));
+
+                if (layer > 0) {
+                    auto previous = nodes.size() - 1 - LAYER_SIZE;
+                    nodes[previous]->precede(*nodes.back());
+                    nodes[previous - i + (i + 1) % LAYER_SIZE]->precede(*nodes.back());
+                }
+            }
+        }
+
+        std::vector<tasks::TaskHandle> handles;
+        handles.reserve(nodes.size());
+        for (auto& node : nodes) {
+            handles.push_back(node->submit());
+        }
+
+        for (auto& handle : handles) {
+            tasks::wait(handle);
+        }
+    };
+
+    tasks::Graph graph;
+    for (auto layer = 0u; layer < LAYER_COUNT; layer++) {
+        for (auto i = 0u; i < LAYER_SIZE; i++) {
+            auto node = graph.add([&work, i](auto&) {
+                work(i);
+            });
+
+            if (layer > 0) {
+                graph.precede(node - LAYER_SIZE, node);
+                graph.precede(node - LAYER_SIZE - i + (i + 1) % LAYER_SIZE, node);
+            }
+        }
+    }
+
+    auto recorded = [&]() {
+        auto task = graph.run();
+        tasks::wait(task);
+    };
+
+    auto measure = [](auto& frame) {
+        frame();
+
+        auto start = Clock::now();
+        for (auto i = 0u; i < FRAME_COUNT; i++) {
+            frame();
+        }
+
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / FRAME_COUNT;
+    };
+
+    auto rebuiltTime = measure(rebuilt);
+    auto recordedTime = measure(recorded);
+
+    tasks::shutdown();
+
+    utils::print("rebuilt every frame: ", rebuiltTime, " us/frame");
+    utils::print("recorded once: ", recordedTime, " us/frame");
+}
+
+TEST_CASE("Parallel for", "[tasks][benchmark]") {
+    static constexpr size_t ELEMENT_COUNT = 1u << 20u;
+    static constexpr size_t RUN_COUNT = 5;
+
+    tasks::init(std::max(2u, std::thread::hardware_concurrency()));
+
+    std::vector<float> values(ELEMENT_COUNT, 1.0f);
+    auto balanced = [&values](size_t i) {
+        values[i] = values[i] * 0.5f + 1.0f;
+    };
+
+    // Work grows with the index, the last elements cost about a hundred times as much as the first ones.
+    auto skewed = [&values](size_t i) {
+        auto rounds = 1u + i * 100u / ELEMENT_COUNT;
+        for (auto round = 0u; round < rounds; round++) {
+            values[i] = values[i] * 0.5f + 1.0f;
+        }
+    };
+
+    auto measure = [](auto&& loop) {
+        double best = std::numeric_limits<double>::max();
+        for (auto run = 0u; run < RUN_COUNT; run++) {
+            auto start = Clock::now();
+            loop();
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        return best;
+    };
+
+    auto report = [&](const char* name, auto& fn) {
+        auto sequential = measure([&]() {
+            for (auto i = 0u; i < ELEMENT_COUNT; i++) {
+                fn(i);
+            }
+        });
+
+        // One task per element, the way loops had to be written before.
+        auto perElement = measure([&]() {
+            auto task = tasks::add([&](auto& task) {
+                for (auto i = 0u; i < ELEMENT_COUNT; i++) {
+                    tasks::add(task, [&fn, i](auto&) {
+                        fn(i);
+                    });
+                }
+            });
+
+            tasks::wait(task);
+        });
+
+        auto fixedGrain = measure([&]() {
+            auto task = tasks::parallel_for(0u, ELEMENT_COUNT, fn, (size_t)4096u);
+            tasks::wait(task);
+        });
+
+        auto automatic = measure([&]() {
+            auto task = tasks::parallel_for(0u, ELEMENT_COUNT, fn);
+            tasks::wait(task);
+        });
+
+        utils::print(name, ": sequential ", sequential, " ms, task per element ", perElement, " ms, grain 4096 ",
+            fixedGrain, " ms, automatic ", automatic, " ms");
+    };
+
+    report("balanced", balanced);
+    report("skewed", skewed);
+
+    tasks::shutdown();
+}
+
+TEST_CASE("Parallel reduce and scan", "[tasks][benchmark]") {
+    static constexpr size_t ELEMENT_COUNT = 1u << 24u;
+    static constexpr size_t RUN_COUNT = 5;
+
+    tasks::init(std::max(2u, std::thread::hardware_concurrency()));
+
+    auto measure = [](auto&& fn) {
+        double best = std::numeric_limits<double>::max();
+        for (auto run = 0u; run < RUN_COUNT; run++) {
+            auto start = Clock::now();
+            fn();
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        return best;
+    };
+
+    std::vector<float> values(ELEMENT_COUNT);
+    for (auto i = 0u; i < ELEMENT_COUNT; i++) {
+        values[i] = (float)(i % 7);
+    }
+
+    volatile float sink = 0.0f;
+    auto reduce = measure([&]() {
+        sink = std::reduce(values.begin(), values.end(), 0.0f);
+    });
+
+    auto parallelReduce = measure([&]() {
+        auto future = tasks::parallel_reduce(values.begin(), values.end(), 0.0f);
+        tasks::wait(future);
+        sink = future.get();
+    });
+
+    // The same reduction without the vectorized leaf kernel.
+    auto scalarReduce = measure([&]() {
+        auto future = tasks::parallel_reduce(values.begin(), values.end(), 0.0f, [](float a, float b) {
+            return a + b;
+        });
+
+        tasks::wait(future);
+        sink = future.get();
+    });
+
+    utils::print("sum of ", ELEMENT_COUNT, " floats: std::reduce ", reduce, " ms, parallel_reduce ", parallelReduce,
+        " ms, parallel_reduce without SIMD ", scalarReduce, " ms");
+
+    std::vector<uint32_t> input(ELEMENT_COUNT), output(ELEMENT_COUNT);
+    for (auto i = 0u; i < ELEMENT_COUNT; i++) {
+        input[i] = i % 7;
+    }
+
+    auto scan = measure([&]() {
+        std::inclusive_scan(input.begin(), input.end(), output.begin());
+    });
+
+    auto parallelScan = measure([&]() {
+        auto task = tasks::parallel_scan(input.begin(), input.end(), output.begin());
+        tasks::wait(task);
+    });
+
+    auto scalarScan = measure([&]() {
+        auto task = tasks::parallel_scan(input.begin(), input.end(), output.begin(), [](uint32_t a, uint32_t b) {
+            return a + b;
+        });
+
+        tasks::wait(task);
+    });
+
+    utils::print("scan of ", ELEMENT_COUNT, " uint32s: std::inclusive_scan ", scan, " ms, parallel_scan ",
+        parallelScan, " ms, parallel_scan without SIMD ", scalarScan, " ms");
+
+    tasks::shutdown();
+}
+
+TEST_CASE("Parallel sort", "[tasks][benchmark]") {
+    static constexpr size_t ELEMENT_COUNT = 1u << 22u;
+    static constexpr size_t RUN_COUNT = 3;
+
+    std::vector<uint32_t> keys(ELEMENT_COUNT);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (auto& key : keys) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        key = (uint32_t)(state >> 32);
+    }
+
+    auto measure = [&keys](auto&& sort) {
+        double best = std::numeric_limits<double>::max();
+        for (auto run = 0u; run < RUN_COUNT; run++) {
+            auto values = keys;
+            auto start = Clock::now();
+            sort(values);
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        return best;
+    };
+
+    auto sequential = measure([](auto& values) {
+        std::sort(values.begin(), values.end());
+    });
+
+    utils::print("std::sort of ", ELEMENT_COUNT, " uint32s: ", sequential, " ms");
+
+    auto maxWorkerCount = std::max(4u, std::thread::hardware_concurrency());
+    for (auto workerCount = 1u; workerCount <= maxWorkerCount; workerCount *= 2) {
+        tasks::init(workerCount);
+
+        auto mergeSort = measure([](auto& values) {
+            auto task = tasks::parallel_sort(values.begin(), values.end());
+            tasks::wait(task);
+        });
+
+        auto radixSort = measure([](auto& values) {
+            auto task = tasks::parallel_radix_sort(values.begin(), values.end());
+            tasks::wait(task);
+        });
+
+        utils::print(workerCount, " workers: parallel_sort ", mergeSort, " ms, parallel_radix_sort ", radixSort, " ms");
+        tasks::shutdown();
+    }
+}
+
+static uint64_t sequentialFib(uint32_t n) {
+    return n < 2 ? n : sequentialFib(n - 1) + sequentialFib(n - 2);
+}
+
+static uint64_t parallelFib(uint32_t n) {
+    // Small enough to not be worth a task.
+    if (n < 16) {
+        return sequentialFib(n);
+    }
+
+    auto future = tasks::async([n](auto&) {
+        return parallelFib(n - 1);
+    });
+
+    auto b = parallelFib(n - 2);
+    tasks::wait(future);
+    return future.get() + b;
+}
+
+TEST_CASE("Recursive fork/join", "[tasks][benchmark]") {
+    static constexpr uint32_t N = 34;
+    static constexpr size_t RUN_COUNT = 3;
+
+    auto measure = [](auto&& fib) {
+        double best = std::numeric_limits<double>::max();
+        for (auto run = 0u; run < RUN_COUNT; run++) {
+            auto start = Clock::now();
+            auto result = fib(N);
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            REQUIRE(result == 5702887u);
+        }
+
+        return best;
+    };
+
+    utils::print("sequential fib(", N, "): ", measure(sequentialFib), " ms");
+
+    auto maxWorkerCount = std::max(4u, std::thread::hardware_concurrency());
+    for (auto workerCount = 1u; workerCount <= maxWorkerCount; workerCount *= 2) {
+        tasks::init(workerCount);
+
+        // Every worker but the foreground one waits from within tasks.
+        auto parallel = measure([](uint32_t n) {
+            std::atomic<uint64_t> result { 0 };
+            auto task = tasks::add([n, &result](auto&) {
+                result = parallelFib(n);
+            });
+
+            tasks::wait(task);
+            return result.load();
+        });
+
+        utils::print(workerCount, " workers: fib(", N, ") with nested waits ", parallel, " ms");
+        tasks::shutdown();
+    }
+}
+
+TEST_CASE("Pipeline", "[tasks][benchmark]") {
+    static constexpr uint32_t ITEM_COUNT = 20000;
+    static constexpr size_t ITEM_SIZE = 256;
+
+    using Item = std::vector<uint32_t>;
+
+    // A synthetic read -> parse -> transform -> write stream, the middle stages cost about ten times as much as
+    // reading or writing an item.
+    auto read = [](uint32_t index) {
+        Item item(ITEM_SIZE);
+        for (auto i = 0u; i < ITEM_SIZE; i++) {
+            item[i] = index * 2654435761u + i;
+        }
+
+        return item;
+    };
+
+    auto parse = [](Item item) {
+        for (auto round = 0u; round < 10u; round++) {
+            for (auto& value : item) {
+                value = value * 1664525u + 1013904223u;
+            }
+        }
+
+        return item;
+    };
+
+    auto transform = [](Item item) {
+        for (auto round = 0u; round < 10u; round++) {
+            for (auto& value : item) {
+                value ^= value >> 13u;
+                value *= 0x5bd1e995u;
+            }
+        }
+
+        return item;
+    };
+
+    uint64_t checksum = 0;
+    auto write = [&checksum](const Item& item) {
+        for (auto value : item) {
+            checksum = checksum * 31u + value;
+        }
+    };
+
+    auto start = Clock::now();
+    for (auto index = 0u; index < ITEM_COUNT; index++) {
+        write(transform(parse(read(index))));
+    }
+
+    auto sequential = std::chrono::duration<double>(Clock::now() - start).count();
+    auto expected = std::exchange(checksum, 0);
+    utils::print("sequential: ", ITEM_COUNT / sequential, " items/s");
+
+    tasks::init(std::max(2u, std::thread::hardware_concurrency()));
+
+    for (auto tokenCount : { 1u, 4u, 16u, 64u }) {
+        start = Clock::now();
+        uint32_t index = 0;
+        auto task = tasks::pipeline(tokenCount, [&](tasks::FlowControl& flow) {
+            if (index == ITEM_COUNT) {
+                flow.stop();
+                return Item();
+            }
+
+            return read(index++);
+        }, tasks::stage(tasks::StageMode::Parallel, parse), tasks::stage(tasks::StageMode::Parallel, transform),
+            tasks::stage(tasks::StageMode::SerialInOrder, write));
+
+        tasks::wait(task);
+        auto duration = std::chrono::duration<double>(Clock::now() - start).count();
+        utils::print(tokenCount, " tokens: ", ITEM_COUNT / duration, " items/s",
+            checksum == expected ? "" : ", wrong checksum");
+        checksum = 0;
+    }
+
+    tasks::shutdown();
+}
+
+#ifdef TASKGRAPH_HAS_COROUTINES
+namespace {
+    tasks::co_task<> awaitTasks(uint32_t count) {
+        for (auto i = 0u; i < count; i++) {
+            co_await tasks::add([](auto&) { });
+        }
+    }
+
+    tasks::co_task<uint32_t> identity(uint32_t value) {
+        co_return value;
+    }
+
+    tasks::co_task<uint32_t> awaitCoroutines(uint32_t count) {
+        uint32_t sum = 0;
+        for (auto i = 0u; i < count; i++) {
+            sum += co_await identity(i);
+        }
+
+        co_return sum;
+    }
+}
+
+TEST_CASE("Coroutine suspend & resume", "[tasks][benchmark]") {
+    static constexpr uint32_t AWAIT_COUNT = 100000;
+
+    tasks::init(std::max(2u, std::thread::hardware_concurrency()));
+
+    auto perAwait = [](auto start) {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / AWAIT_COUNT;
+    };
+
+    // Spawning a task and blocking the foreground thread until it has finished, for reference.
+    auto start = Clock::now();
+    for (auto i = 0u; i < AWAIT_COUNT; i++) {
+        auto task = tasks::add([](auto&) { });
+        tasks::wait(task);
+    }
+
+    auto blocking = perAwait(start);
+
+    // Spawning a task and suspending until it has finished, which submits a task resuming the coroutine.
+    start = Clock::now();
+    auto future = tasks::async(awaitTasks(AWAIT_COUNT));
+    tasks::wait(future);
+    auto suspending = perAwait(start);
+
+    // Awaiting a coroutine which returns right away, without leaving the worker.
+    start = Clock::now();
+    auto sum = tasks::async(awaitCoroutines(AWAIT_COUNT));
+    tasks::wait(sum);
+    auto nested = perAwait(start);
+
+    utils::print("per await: blocking wait ", blocking, " ns, co_await task ", suspending, " ns, co_await co_task ",
+        nested, " ns");
+
+    tasks::shutdown();
+}
+#endif
@@ -0,0 +1,282 @@
+#pragma once
+
+// Coroutine tasks need C++20, configure with `TASKGRAPH_EnableCoroutines` to enable them.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+#define TASKGRAPH_HAS_COROUTINES 1
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "TaskArena.h"
+#include "TaskFuture.h"
+#include "TaskGraph.h"
+#include "Worker.h"
+
+template<typename T>
+class CoTask;
+
+// Payload of a task resuming a suspended coroutine.
+class CoResumeFn {
+private:
+    std::coroutine_handle<> coroutine;
+
+public:
+    explicit CoResumeFn(std::coroutine_handle<> inCoroutine)
+        :coroutine { inCoroutine } {
+    }
+
+    void operator()(Task&) {
+        coroutine.resume();
+    }
+};
+
+// Suspends a coroutine until a task and all of its subtasks have finished. The resumption is a successor of the
+// task, so it's submitted by the worker finishing the task and pushed onto that worker's deque.
+class CoTaskAwaiter {
+private:
+    PoolItemHandle<Task> task;
+    Task* runTask;
+
+public:
+    CoTaskAwaiter(PoolItemHandle<Task> inTask, Task* inRunTask)
+        :task { inTask }, runTask { inRunTask } {
+    }
+
+    bool await_ready() {
+        return !task.valid();
+    }
+
+    bool await_suspend(std::coroutine_handle<> coroutine) {
+        // The awaited task is pinned so that its slot can't be reused, by the resumption among others, until the
+        // resumption is linked to it. If it has been released already, the coroutine carries on right away.
+        if (!task.pin()) {
+            return false;
+        }
+
+        // N.B. The coroutine may be resumed by another worker as soon as the resumption is submitted, which
+        // destroys this awaiter along with the frame it's stored in.
+        auto* predecessor = *task;
+        auto parent = PoolItemHandle<Task>(runTask);
+        auto resume = TaskGraph::allocate(CoResumeFn(coroutine), &parent);
+        predecessor->precede(*resume);
+        task.unpin();
+        resume->submit();
+        return true;
+    }
+
+    void await_resume() {
+    }
+};
+
+// Runs a child coroutine right away in the worker of its parent, which is resumed by symmetric transfer once
+// the child returns.
+template<typename T>
+class CoTaskChildAwaiter {
+private:
+    CoTask<T> child;
+    Task* runTask;
+
+public:
+    CoTaskChildAwaiter(CoTask<T>&& inChild, Task* inRunTask)
+        :child(std::move(inChild)), runTask { inRunTask } {
+    }
+
+    bool await_ready() {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> coroutine) {
+        auto& promise = child.coroutine.promise();
+        promise.runTask = runTask;
+        promise.continuation = coroutine;
+        return child.coroutine;
+    }
+
+    T await_resume() {
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*child.coroutine.promise().value);
+        }
+    }
+};
+
+// Promise state which doesn't depend on the result. Frames are allocated like oversized task payloads, from the
+// arena of the allocating worker.
+class CoTaskPromiseBase {
+public:
+    // Every resumption of the coroutine is a subtask of this task, which finishes once the coroutine has.
+    Task* runTask = nullptr;
+    // Coroutine awaiting this one, resumed once it returns.
+    std::coroutine_handle<> continuation;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> coroutine) noexcept {
+            auto next = coroutine.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {
+        }
+    };
+
+    static void* operator new(size_t size) {
+        return Worker::allocatePayload(size, alignof(std::max_align_t));
+    }
+
+    static void operator delete(void* data) {
+        TaskArena::free(data);
+    }
+
+    std::suspend_always initial_suspend() noexcept {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() {
+        std::terminate();
+    }
+
+    CoTaskAwaiter await_transform(PoolItemHandle<Task> task) {
+        return CoTaskAwaiter(task, runTask);
+    }
+
+    template<typename R>
+    auto await_transform(TaskFuture<R>& future) {
+        struct FutureAwaiter : CoTaskAwaiter {
+            TaskFuture<R>& future;
+
+            decltype(auto) await_resume() {
+                if constexpr (!std::is_void_v<R>) {
+                    return future.get();
+                }
+            }
+        };
+
+        return FutureAwaiter { CoTaskAwaiter(future.getTask(), runTask), future };
+    }
+
+    template<typename T>
+    CoTaskChildAwaiter<T> await_transform(CoTask<T>&& child) {
+        return CoTaskChildAwaiter<T>(std::move(child), runTask);
+    }
+};
+
+template<typename T>
+class CoTaskPromise : public CoTaskPromiseBase {
+public:
+    std::optional<T> value;
+
+    CoTask<T> get_return_object() {
+        return CoTask<T>(std::coroutine_handle<CoTaskPromise>::from_promise(*this));
+    }
+
+    template<typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+};
+
+template<>
+class CoTaskPromise<void> : public CoTaskPromiseBase {
+public:
+    CoTask<void> get_return_object();
+
+    void return_void() {
+    }
+};
+
+// Coroutine run as a task, which can `co_await` task handles, futures and other coroutine tasks. Awaiting a task
+// suspends the coroutine instead of blocking the worker, and it's resumed by a task submitted once the awaited
+// task has finished. Coroutines start suspended, and are run with `tasks::async` or awaited by another coroutine.
+template<typename T = void>
+class CoTask {
+    template<typename>
+    friend class CoTaskChildAwaiter;
+
+    template<typename>
+    friend class CoTaskFn;
+
+public:
+    using promise_type = CoTaskPromise<T>;
+
+private:
+    std::coroutine_handle<promise_type> coroutine;
+
+public:
+    explicit CoTask(std::coroutine_handle<promise_type> inCoroutine)
+        :coroutine { inCoroutine } {
+    }
+
+    CoTask(CoTask&& other) noexcept
+        :coroutine { std::exchange(other.coroutine, nullptr) } {
+    }
+
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+
+    ~CoTask() {
+        if (coroutine) {
+            coroutine.destroy();
+        }
+    }
+};
+
+inline CoTask<void> CoTaskPromise<void>::get_return_object() {
+    return CoTask<void>(std::coroutine_handle<CoTaskPromise>::from_promise(*this));
+}
+
+// Payload of the task running a coroutine. Like `AsyncTaskFn`, the result is stored and completed once the
+// payload is destroyed, which is once the coroutine has returned and all of its resumptions have finished.
+template<typename T>
+class CoTaskFn {
+private:
+    CoTask<T> coTask;
+    Task* stateBox;
+
+public:
+    CoTaskFn(CoTask<T>&& inCoTask, Task* inStateBox)
+        :coTask(std::move(inCoTask)), stateBox { inStateBox } {
+    }
+
+    CoTaskFn(CoTaskFn&& other) noexcept
+        :coTask(std::move(other.coTask)), stateBox { std::exchange(other.stateBox, nullptr) } {
+    }
+
+    CoTaskFn(const CoTaskFn&) = delete;
+    CoTaskFn& operator=(const CoTaskFn&) = delete;
+
+    ~CoTaskFn() {
+        if (stateBox == nullptr) {
+            return;
+        }
+
+        auto& state = FutureState<T>::of(stateBox);
+        if constexpr (std::is_void_v<T>) {
+            if (coTask.coroutine.done()) {
+                state.value.emplace();
+            }
+        } else if (auto& value = coTask.coroutine.promise().value; value.has_value()) {
+            state.value.emplace(std::move(*value));
+        }
+
+        state.complete();
+        FutureState<T>::release(stateBox);
+    }
+
+    void operator()(Task& task) {
+        coTask.coroutine.promise().runTask = &task;
+        coTask.coroutine.resume();
+    }
+};
+
+#endif
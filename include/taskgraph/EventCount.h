@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if !defined(__linux__)
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// Lets threads sleep until an event without missing notifications that happen between checking a condition and
+// going to sleep. Waiters call `prepareWait()`, re-check their condition, and then either `cancelWait()` or
+// `wait()`. Notifiers make the condition true before calling `notify()`, which is cheap if nobody is waiting.
+// Backed by a futex on Linux and a condition variable elsewhere.
+class EventCount {
+public:
+    using Key = uint32_t;
+
+private:
+    std::atomic<uint32_t> epoch;
+    std::atomic<uint32_t> waiters;
+
+#if !defined(__linux__)
+    std::mutex mutex;
+    std::condition_variable condition;
+#endif
+
+public:
+    EventCount();
+
+    [[nodiscard]] Key prepareWait();
+    void cancelWait();
+    void wait(Key key);
+
+    // Wakes up to `count` waiters.
+    void notify(uint32_t count);
+    void notifyAll();
+
+    [[nodiscard]] uint32_t waiterCount() const;
+};
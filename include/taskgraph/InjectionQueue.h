@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+class Task;
+
+// Bounded lock-free multi-producer multi-consumer queue used to hand tasks submitted from threads that
+// aren't workers over to the workers. Based on Dmitry Vyukov's bounded MPMC queue: every cell carries a
+// sequence number which tells producers and consumers whether it's their turn to use the cell.
+class InjectionQueue {
+private:
+    static constexpr size_t CAPACITY = 4096u;
+    static constexpr size_t CELL_LOOKUP_MASK = CAPACITY - 1u;
+
+    static_assert((CAPACITY != 0) && ((CAPACITY & (CAPACITY - 1)) == 0), "capacity should be a power of 2");
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Task* task;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    alignas(std::hardware_destructive_interference_size) std::atomic<size_t> enqueuePos;
+    alignas(std::hardware_destructive_interference_size) std::atomic<size_t> dequeuePos;
+
+public:
+    InjectionQueue();
+
+    // Returns `false` if the queue is full.
+    bool push(Task* task);
+    Task* pop();
+    size_t size() const;
+};
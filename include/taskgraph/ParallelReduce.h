@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include "RangeSplitter.h"
+#include "SimdKernels.h"
+#include "TaskFuture.h"
+#include "TaskGraph.h"
+
+// Folds `[first, last)` into `init` with `op`, summing with the vectorized kernels where possible.
+template<typename Iterator, typename T, typename Op>
+T reduceRange(Iterator first, Iterator last, T init, const Op& op) {
+    if constexpr (SimdKernels::isSum<Op, T>() && SimdKernels::isContiguous<Iterator, T>()) {
+        return first < last ? SimdKernels::sum(&*first, (size_t)(last - first), init) : init;
+    } else {
+        for (; first != last; ++first) {
+            init = op(std::move(init), *first);
+        }
+
+        return init;
+    }
+}
+
+template<typename T, typename Op>
+struct ReduceContext {
+    T identity;
+    Op op;
+    size_t grainSize;
+};
+
+// Partial result of a subtask of a reduction, stored in a `TaskBox`.
+template<typename T>
+struct ReduceSlot {
+    T value;
+    // Slot of the subtask reducing the part of the range right after this one.
+    Task* next;
+};
+
+// Payload of the tasks of `tasks::parallel_reduce`. Ranges are split like `RangeSplitter::forEachChunk` does,
+// and every subtask gets a slot for its partial result. Once a task and all of its subtasks have finished, its
+// payload is destroyed and folds the slots of its subtasks into its own result from left to right, so `op` only
+// has to be associative. The root task stores the result in the state of the future, and owns the context.
+template<typename Iterator, typename T, typename Op>
+class ReduceTaskFn {
+private:
+    using Context = ReduceContext<T, Op>;
+
+    Iterator begin;
+    Iterator end;
+    Task* contextBox;
+    // `ReduceSlot<T>` box, or the `FutureState<T>` box for the root.
+    Task* resultBox;
+    // Slots of the subtasks the range was split between, from left to right.
+    Task* children;
+    bool root;
+
+    T* getResult() {
+        if (!root) {
+            return &TaskBox<ReduceSlot<T>>::get(resultBox).value;
+        }
+
+        auto& value = FutureState<T>::of(resultBox).value;
+        return value.has_value() ? &*value : nullptr;
+    }
+
+public:
+    ReduceTaskFn(Iterator inBegin, Iterator inEnd, Task* inContextBox, Task* inResultBox, bool inRoot)
+        :begin { inBegin }, end { inEnd }, contextBox { inContextBox }, resultBox { inResultBox },
+        children { nullptr }, root { inRoot } {
+    }
+
+    ReduceTaskFn(ReduceTaskFn&& other) noexcept
+        :begin { other.begin }, end { other.end }, contextBox { other.contextBox },
+        resultBox { std::exchange(other.resultBox, nullptr) }, children { std::exchange(other.children, nullptr) },
+        root { other.root } {
+    }
+
+    ReduceTaskFn(const ReduceTaskFn&) = delete;
+    ReduceTaskFn& operator=(const ReduceTaskFn&) = delete;
+
+    ~ReduceTaskFn() {
+        if (resultBox == nullptr) {
+            return;
+        }
+
+        auto& context = TaskBox<Context>::get(contextBox);
+        auto* result = getResult();
+        while (children != nullptr) {
+            auto* slot = children;
+            auto& child = TaskBox<ReduceSlot<T>>::get(slot);
+            if (result != nullptr) {
+                *result = context.op(std::move(*result), std::move(child.value));
+            }
+
+            children = child.next;
+            TaskBox<ReduceSlot<T>>::destroy(slot);
+        }
+
+        if (root) {
+            TaskBox<Context>::destroy(contextBox);
+            FutureState<T>::of(resultBox).complete();
+            FutureState<T>::release(resultBox);
+        }
+    }
+
+    void operator()(Task& task) {
+        auto& context = TaskBox<Context>::get(contextBox);
+        T partial = context.identity;
+        RangeSplitter::split(begin, end, context.grainSize, [&](Iterator chunkBegin, Iterator chunkEnd) {
+            partial = reduceRange(chunkBegin, chunkEnd, std::move(partial), context.op);
+        }, [&](Iterator middle, Iterator last) {
+            // Split off parts are always to the right of the ones before, so the newest slot goes first.
+            children = TaskBox<ReduceSlot<T>>::create(ReduceSlot<T> { context.identity, children });
+            auto parent = PoolItemHandle<Task>(&task);
+            TaskGraph::allocate(ReduceTaskFn(middle, last, contextBox, children, false), &parent)->submit();
+        });
+
+        if (root) {
+            FutureState<T>::of(resultBox).value.emplace(std::move(partial));
+        } else {
+            TaskBox<ReduceSlot<T>>::get(resultBox).value = std::move(partial);
+        }
+    }
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+#include "RangeSplitter.h"
+#include "SimdKernels.h"
+#include "TaskGraph.h"
+
+// Payload of the task of `tasks::parallel_scan`, an inclusive scan in two passes over blocks of the range. The
+// first pass folds every block but the last one, then the block sums are scanned sequentially, and the second
+// pass scans every block starting from the sum of the blocks before it. Ranges too small to be worth splitting
+// are scanned in a single block.
+template<typename InputIterator, typename OutputIterator, typename Op>
+class ScanTaskFn {
+private:
+    using T = typename std::iterator_traits<InputIterator>::value_type;
+
+    static constexpr bool IS_SIMD_SUM = SimdKernels::isSum<Op, T>()
+        && SimdKernels::isContiguous<InputIterator, T>() && SimdKernels::isContiguous<OutputIterator, T>();
+
+    InputIterator first;
+    OutputIterator dest;
+    size_t count;
+    size_t blockSize;
+    Op op;
+    // Sums of the blocks before the end of every block, once the first pass and the sequential scan are done.
+    std::vector<T> blockSums;
+
+    size_t getBlockBegin(size_t block) const {
+        return std::min(block * blockSize, count);
+    }
+
+    T reduceBlock(size_t block) const {
+        auto begin = getBlockBegin(block), end = getBlockBegin(block + 1);
+        if constexpr (IS_SIMD_SUM) {
+            return SimdKernels::sum(&*(first + begin), end - begin, T {});
+        } else {
+            T sum = first[begin];
+            for (auto i = begin + 1; i < end; i++) {
+                sum = op(std::move(sum), first[i]);
+            }
+
+            return sum;
+        }
+    }
+
+    void scanBlock(size_t block) {
+        auto begin = getBlockBegin(block), end = getBlockBegin(block + 1);
+        if (begin == end) {
+            return;
+        }
+
+        if constexpr (IS_SIMD_SUM) {
+            SimdKernels::inclusiveScan(&*(first + begin), &*(dest + begin), end - begin,
+                block > 0 ? blockSums[block - 1] : T {});
+        } else {
+            T sum = block > 0 ? op(blockSums[block - 1], first[begin]) : T(first[begin]);
+            dest[begin] = sum;
+            for (auto i = begin + 1; i < end; i++) {
+                sum = op(std::move(sum), first[i]);
+                dest[i] = sum;
+            }
+        }
+    }
+
+public:
+    // Blocks are at least this large, and there are at most this many blocks per worker.
+    static constexpr size_t MIN_BLOCK_SIZE = 4096u;
+    static constexpr size_t BLOCKS_PER_WORKER = 4u;
+
+    ScanTaskFn(InputIterator inFirst, InputIterator inLast, OutputIterator inDest, Op inOp)
+        :first { inFirst }, dest { inDest }, count { inFirst < inLast ? (size_t)(inLast - inFirst) : 0u },
+        blockSize { 0 }, op(std::move(inOp)) {
+    }
+
+    void operator()(Task& task) {
+        auto* taskGraph = TaskGraph::get();
+        auto workerCount = taskGraph != nullptr ? taskGraph->workers.size() : 1u;
+        auto blockCount = std::max<size_t>(std::min(count / MIN_BLOCK_SIZE, workerCount * BLOCKS_PER_WORKER), 1u);
+        blockSize = (count + blockCount - 1) / blockCount;
+        if (blockCount == 1) {
+            scanBlock(0);
+            return;
+        }
+
+        blockSums.resize(blockCount - 1);
+        TaskChainBuilder(PoolItemHandle<Task>(&task)).add([this](Task& pass) {
+            RangeSplitter::forEachChunk(pass, size_t(0), blockSums.size(), 1u, [this](size_t begin, size_t end) {
+                for (auto block = begin; block < end; block++) {
+                    blockSums[block] = reduceBlock(block);
+                }
+            });
+        })->add([this, blockCount](Task& pass) {
+            for (size_t block = 1; block < blockSums.size(); block++) {
+                blockSums[block] = op(blockSums[block - 1], blockSums[block]);
+            }
+
+            RangeSplitter::forEachChunk(pass, size_t(0), blockCount, 1u, [this](size_t begin, size_t end) {
+                for (auto block = begin; block < end; block++) {
+                    scanBlock(block);
+                }
+            });
+        })->submit();
+    }
+};
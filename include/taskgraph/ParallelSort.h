@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "RangeSplitter.h"
+#include "TaskGraph.h"
+
+// Payload of the task of `tasks::parallel_sort`, a merge sort alternating between the range and a buffer of the
+// same size. Both halves of a range are sorted into the other array, and then merged back from there. Merges are
+// split as well, by finding where the middle of the larger run goes in the smaller one. Ranges and merges of at
+// most `cutoff` values are sorted with `std::sort` and merged with `std::merge`.
+template<typename Iterator, typename Compare>
+class MergeSortTaskFn {
+private:
+    using T = typename std::iterator_traits<Iterator>::value_type;
+
+    Iterator first;
+    size_t count;
+    Compare compare;
+    size_t cutoff;
+    std::vector<T> buffer;
+
+    void sort(Task& task, size_t begin, size_t end, bool intoBuffer) {
+        if (end - begin <= cutoff) {
+            std::sort(first + begin, first + end, compare);
+            if (intoBuffer) {
+                std::move(first + begin, first + end, buffer.begin() + begin);
+            }
+
+            return;
+        }
+
+        auto middle = begin + (end - begin) / 2;
+        TaskChainBuilder(PoolItemHandle<Task>(&task)).add([this, begin, middle, end, intoBuffer](Task& halves) {
+            auto parent = PoolItemHandle<Task>(&halves);
+            TaskGraph::allocate([this, middle, end, intoBuffer](Task& half) {
+                sort(half, middle, end, !intoBuffer);
+            }, &parent)->submit();
+
+            sort(halves, begin, middle, !intoBuffer);
+        })->add([this, begin, middle, end, intoBuffer](Task& merged) {
+            if (intoBuffer) {
+                merge(merged, first + begin, first + middle, first + middle, first + end, buffer.begin() + begin);
+            } else {
+                merge(merged, buffer.begin() + begin, buffer.begin() + middle, buffer.begin() + middle,
+                    buffer.begin() + end, first + begin);
+            }
+        })->submit();
+    }
+
+    template<typename Source, typename Destination>
+    void merge(Task& task, Source a, Source aEnd, Source b, Source bEnd, Destination out) {
+        while ((size_t)((aEnd - a) + (bEnd - b)) > cutoff) {
+            if (aEnd - a < bEnd - b) {
+                std::swap(a, b);
+                std::swap(aEnd, bEnd);
+            }
+
+            auto aMiddle = a + (aEnd - a) / 2;
+            auto bMiddle = std::lower_bound(b, bEnd, *aMiddle, compare);
+            auto outMiddle = out + (aMiddle - a) + (bMiddle - b);
+
+            auto parent = PoolItemHandle<Task>(&task);
+            TaskGraph::allocate([this, aMiddle, aEnd, bMiddle, bEnd, outMiddle](Task& subtask) {
+                merge(subtask, aMiddle, aEnd, bMiddle, bEnd, outMiddle);
+            }, &parent)->submit();
+
+            aEnd = aMiddle;
+            bEnd = bMiddle;
+        }
+
+        std::merge(std::make_move_iterator(a), std::make_move_iterator(aEnd), std::make_move_iterator(b),
+            std::make_move_iterator(bEnd), out, compare);
+    }
+
+public:
+    // Ranges are split into at least this many parts per worker, of at least `MIN_CUTOFF` values.
+    static constexpr size_t PARTS_PER_WORKER = 8u;
+    static constexpr size_t MIN_CUTOFF = 4096u;
+
+    MergeSortTaskFn(Iterator inFirst, Iterator inLast, Compare inCompare)
+        :first { inFirst }, count { inFirst < inLast ? (size_t)(inLast - inFirst) : 0u },
+        compare(std::move(inCompare)), cutoff { 0 } {
+    }
+
+    void operator()(Task& task) {
+        auto* taskGraph = TaskGraph::get();
+        auto workerCount = taskGraph != nullptr ? taskGraph->workers.size() : 1u;
+        cutoff = std::max(count / (workerCount * PARTS_PER_WORKER), MIN_CUTOFF);
+        if (count > cutoff) {
+            buffer.resize(count);
+        }
+
+        sort(task, 0, count, false);
+    }
+};
+
+// Payload of the task of `tasks::parallel_radix_sort`, a least significant digit radix sort of integers with 8-bit
+// digits. Every digit is sorted in two steps over blocks of the range: counting the digits of every block, and
+// then scattering the values of every block to offsets computed from the counts, which keeps the sort stable.
+// Digits which are the same for all values are skipped.
+template<typename T>
+class RadixSortTaskFn {
+private:
+    static_assert(std::is_integral_v<T>, "radix sort keys have to be integers");
+
+    using Key = std::make_unsigned_t<T>;
+    using Counts = std::array<size_t, 256>;
+
+    T* data;
+    size_t count;
+    size_t blockSize;
+    std::vector<T> buffer;
+    // Counts of every digit per block, and then offsets where the values of the block with that digit go.
+    std::vector<Counts> blockCounts;
+    T* source;
+    T* destination;
+
+    static size_t getDigit(T value, uint32_t digit) {
+        auto key = (Key)value;
+        if constexpr (std::is_signed_v<T>) {
+            // Flipping the sign bit orders negative values before positive ones.
+            key ^= (Key)((Key)1 << (sizeof(T) * 8 - 1));
+        }
+
+        return (size_t)(key >> (digit * 8)) & 0xFF;
+    }
+
+    size_t getBlockBegin(size_t block) const {
+        return std::min(block * blockSize, count);
+    }
+
+    void countDigits(uint32_t digit, size_t block) {
+        auto& counts = blockCounts[block];
+        counts.fill(0);
+        for (auto i = getBlockBegin(block), end = getBlockBegin(block + 1); i < end; i++) {
+            counts[getDigit(source[i], digit)]++;
+        }
+    }
+
+    // Turns the counts into offsets, or returns false if all values have the same digit.
+    bool computeOffsets() {
+        size_t offset = 0;
+        for (auto value = 0u; value < 256; value++) {
+            auto start = offset;
+            for (auto& counts : blockCounts) {
+                offset += std::exchange(counts[value], offset);
+            }
+
+            if (offset - start == count) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+public:
+    // Blocks are at least this large, and there are at most this many blocks per worker.
+    static constexpr size_t MIN_BLOCK_SIZE = 16384u;
+    static constexpr size_t BLOCKS_PER_WORKER = 4u;
+
+    RadixSortTaskFn(T* inData, size_t inCount)
+        :data { inData }, count { inCount }, blockSize { 0 }, source { inData }, destination { nullptr } {
+    }
+
+    void operator()(Task& task) {
+        auto* taskGraph = TaskGraph::get();
+        auto workerCount = taskGraph != nullptr ? taskGraph->workers.size() : 1u;
+        auto blockCount = std::min(count / MIN_BLOCK_SIZE, workerCount * BLOCKS_PER_WORKER);
+        if (blockCount <= 1) {
+            std::sort(data, data + count);
+            return;
+        }
+
+        blockSize = (count + blockCount - 1) / blockCount;
+        blockCounts.resize(blockCount);
+        buffer.resize(count);
+        destination = buffer.data();
+
+        auto chain = TaskChainBuilder(PoolItemHandle<Task>(&task));
+        auto* builder = &chain;
+        for (auto digit = 0u; digit < sizeof(T); digit++) {
+            builder = builder->add([this, digit](Task& step) {
+                RangeSplitter::forEachChunk(step, size_t(0), blockCounts.size(), 1u, [this, digit](size_t begin,
+                    size_t end) {
+                    for (auto block = begin; block < end; block++) {
+                        countDigits(digit, block);
+                    }
+                });
+            })->add([this, digit](Task& step) {
+                if (!computeOffsets()) {
+                    return;
+                }
+
+                RangeSplitter::forEachChunk(step, size_t(0), blockCounts.size(), 1u,
+                    [this, digit, from = source, to = destination](size_t begin, size_t end) {
+                    for (auto block = begin; block < end; block++) {
+                        auto& offsets = blockCounts[block];
+                        for (auto i = getBlockBegin(block), blockEnd = getBlockBegin(block + 1); i < blockEnd; i++) {
+                            to[offsets[getDigit(from[i], digit)]++] = from[i];
+                        }
+                    }
+                });
+
+                std::swap(source, destination);
+            });
+        }
+
+        builder->add([this](Task& step) {
+            if (source == data) {
+                return;
+            }
+
+            RangeSplitter::forEachChunk(step, size_t(0), count, blockSize, [this](size_t begin, size_t end) {
+                std::copy(source + begin, source + end, data + begin);
+            });
+        })->submit();
+    }
+};
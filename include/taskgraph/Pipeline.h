@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+class Task;
+
+enum class PipelineStageMode : uint8_t {
+    // Runs on any number of tokens at once.
+    Parallel = 0,
+    // Runs on one token at a time, in the order the input produced them.
+    SerialInOrder = 1,
+    // Runs on one token at a time, in the order they arrive at the stage.
+    SerialOutOfOrder = 2
+};
+
+// Passed to the input of a pipeline, which calls `stop()` instead of producing another item once it's done.
+class PipelineFlowControl {
+private:
+    bool stopped = false;
+
+public:
+    void stop() {
+        stopped = true;
+    }
+
+    [[nodiscard]] bool isStopped() const {
+        return stopped;
+    }
+};
+
+template<typename Fn>
+struct PipelineStage {
+    PipelineStageMode mode;
+    Fn fn;
+};
+
+// Schedules tokens through the stages of a pipeline. Every item produced by the input travels through the stages
+// on one of a fixed number of tokens, and the input only runs while a token is free, which bounds the memory used
+// by items in flight. A token keeps running stages in the task which produced it for as long as it can, and only
+// gets a task of its own when it had to wait for a serial stage. Every task is a subtask of the task running the
+// pipeline, which finishes once the input has stopped and all tokens have made it through the last stage.
+class Pipeline {
+public:
+    struct Token {
+        uint64_t sequence = 0;
+        uint32_t stage = 0;
+    };
+
+    // Runs `stage` of `stages` on `token`, the input is stage 0.
+    using StageFn = void (*)(void* stages, uint32_t stage, Token& token, PipelineFlowControl& flow);
+
+private:
+    struct SerialStage {
+        std::mutex mutex;
+        bool inOrder;
+        bool busy;
+        uint64_t nextSequence;
+        // Tokens waiting for the stage, at their sequence number modulo the token count for in-order stages, or in
+        // a ring in arrival order otherwise.
+        std::vector<Token*> pending;
+        size_t pendingBegin;
+        size_t pendingCount;
+
+        SerialStage(bool inInOrder, size_t tokenCount);
+    };
+
+    void* stages;
+    StageFn runStage;
+    uint32_t stageCount;
+    std::vector<Token*> tokens;
+    // Serial stages by index, or null for parallel ones.
+    std::vector<std::unique_ptr<SerialStage>> serialStages;
+
+    std::mutex inputMutex;
+    std::vector<Token*> freeTokens;
+    bool inputBusy;
+    bool stopped;
+    uint64_t nextSequence;
+    Task* runTask;
+
+    void spawn(Token* token);
+    void spawnInput();
+    void pull();
+    void process(Token* token);
+    bool enter(Token* token);
+    void leave(uint32_t stage);
+    void release(Token* token);
+
+public:
+    Pipeline(const std::vector<PipelineStageMode>& modes, std::vector<Token*> inTokens, void* inStages,
+        StageFn inRunStage);
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    void run(Task& task);
+};
+
+// Callable of the input, or of a `PipelineStage`.
+template<typename S>
+struct PipelineStageFn {
+    using Type = S;
+};
+
+template<typename Fn>
+struct PipelineStageFn<PipelineStage<Fn>> {
+    using Type = Fn;
+};
+
+// Values of a pipeline's tokens, the output of any stage but the last one.
+template<typename Variant, typename In, typename... Fns>
+struct PipelineValues;
+
+template<typename... Values, typename In, typename Fn>
+struct PipelineValues<std::variant<Values...>, In, Fn> {
+    using Type = std::variant<Values...>;
+};
+
+template<typename... Values, typename In, typename Fn, typename Next, typename... Rest>
+struct PipelineValues<std::variant<Values...>, In, Fn, Next, Rest...> {
+    using Out = std::decay_t<std::invoke_result_t<typename PipelineStageFn<Fn>::Type&, In>>;
+    static_assert(!std::is_void_v<Out>, "only the last stage of a pipeline may return void");
+
+    using Type = typename PipelineValues<std::variant<Values..., Out>, Out&&, Next, Rest...>::Type;
+};
+
+// Payload of the task running a pipeline with the input `Input` and the stages `Stages`. The state is heap
+// allocated once per pipeline, as tasks refer to it while it runs.
+template<typename Input, typename... Stages>
+class PipelineTaskFn {
+private:
+    static constexpr uint32_t STAGE_COUNT = sizeof...(Stages) + 1;
+
+    using Values = typename PipelineValues<std::variant<std::monostate>, PipelineFlowControl&, Input, Stages...>::Type;
+
+    struct ValueToken : Pipeline::Token {
+        Values value;
+    };
+
+    struct State {
+        std::tuple<Input, Stages...> fns;
+        std::vector<ValueToken> tokens;
+        Pipeline pipeline;
+
+        State(size_t tokenCount, Input&& input, Stages&&... stages)
+            :fns(std::move(input), std::move(stages)...), tokens(tokenCount),
+            pipeline({ PipelineStageMode::SerialInOrder, stages.mode... }, getTokens(), &fns, &runStage) {
+        }
+
+        std::vector<Pipeline::Token*> getTokens() {
+            std::vector<Pipeline::Token*> pointers;
+            for (auto& token : tokens) {
+                pointers.push_back(&token);
+            }
+
+            return pointers;
+        }
+    };
+
+    std::unique_ptr<State> state;
+
+    template<size_t I>
+    static void runStageAt(std::tuple<Input, Stages...>& fns, ValueToken& token, PipelineFlowControl& flow) {
+        if constexpr (I == 0) {
+            token.value.template emplace<1>(std::get<0>(fns)(flow));
+            if (flow.isStopped()) {
+                token.value.template emplace<0>();
+            }
+        } else if constexpr (I + 1 == STAGE_COUNT) {
+            std::get<I>(fns).fn(std::move(std::get<I>(token.value)));
+            token.value.template emplace<0>();
+        } else {
+            token.value.template emplace<I + 1>(std::get<I>(fns).fn(std::move(std::get<I>(token.value))));
+        }
+    }
+
+    template<size_t... I>
+    static void runStage(std::tuple<Input, Stages...>& fns, uint32_t stage, ValueToken& token,
+        PipelineFlowControl& flow, std::index_sequence<I...>) {
+        ((stage == I ? runStageAt<I>(fns, token, flow) : void()), ...);
+    }
+
+    static void runStage(void* fns, uint32_t stage, Pipeline::Token& token, PipelineFlowControl& flow) {
+        runStage(*(std::tuple<Input, Stages...>*)fns, stage, static_cast<ValueToken&>(token), flow,
+            std::make_index_sequence<STAGE_COUNT>());
+    }
+
+public:
+    PipelineTaskFn(size_t tokenCount, Input&& input, Stages&&... stages)
+        :state(std::make_unique<State>(tokenCount, std::move(input), std::move(stages)...)) {
+    }
+
+    void operator()(Task& task) {
+        state->pipeline.run(task);
+    }
+};
@@ -4,12 +4,85 @@
 #include <atomic>
 #include <cassert>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
 
-template<typename T>
-struct PoolItem {
-public:
-    void* next = nullptr;
+// Bookkeeping of a pool item, kept apart from the item itself so that items fill whole cache lines.
+struct PoolItemMeta {
+    // Set in `pins` once a pinned item has been released, the last pin then returns it to the free list.
+    static constexpr uint32_t RELEASE_PENDING = 1u << 31u;
+
+    // Index of the next free item, only meaningful while the item is in the pool's free list.
+    std::atomic<uint32_t> nextFree = 0u;
+    // Number of handles pinning the item, see `PoolItemHandle::pin()`.
+    std::atomic<uint32_t> pins = 0u;
     std::atomic<uint64_t> version = 0u;
+};
+
+// Pools allocate items in slabs aligned to `ALIGNMENT` that start with this header, so the header of any item is
+// found by masking its address. The rest of the slab is made of groups, each a cache line holding the metadata of
+// the group's items followed by the items themselves.
+struct alignas(std::hardware_destructive_interference_size) PoolSlabHeader {
+    static constexpr size_t ALIGNMENT = 512u * 1024u;
+    static constexpr size_t LINE_SIZE = std::hardware_destructive_interference_size;
+
+    void* pool;
+    // Returns an item to its pool, which lets items be released without knowing their exact type.
+    void (*releaseItem)(void* item);
+    // Puts an item released while it was pinned back on its pool's free list.
+    void (*recycleItem)(void* item);
+    uint8_t* groups;
+    // Pool index of the first item in the slab.
+    uint32_t firstIndex;
+    uint32_t itemCount;
+    uint32_t itemStride;
+    uint32_t groupStride;
+
+    static PoolSlabHeader* fromAddress(const void* address) {
+        return (PoolSlabHeader*)((uintptr_t)address & ~(uintptr_t)(ALIGNMENT - 1));
+    }
+
+    PoolItemMeta& metaOf(const void* item) {
+        auto offset = (size_t)((const uint8_t*)item - groups);
+        auto* group = groups + offset / groupStride * groupStride;
+        return ((PoolItemMeta*)group)[(offset % groupStride - LINE_SIZE) / itemStride];
+    }
+};
+
+template<typename T>
+struct PoolItem;
+
+template<typename T>
+struct PoolSlabLayout {
+    static constexpr size_t LINE_SIZE = PoolSlabHeader::LINE_SIZE;
+    static constexpr size_t GROUP_SIZE = LINE_SIZE / sizeof(PoolItemMeta);
+    static constexpr size_t GROUP_STRIDE = LINE_SIZE + GROUP_SIZE * sizeof(PoolItem<T>);
+
+    static constexpr size_t slabBytes(size_t itemCount) {
+        return sizeof(PoolSlabHeader) + (itemCount + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_STRIDE;
+    }
+
+    static PoolItem<T>* item(uint8_t* groups, size_t index) {
+        return (PoolItem<T>*)(groups + index / GROUP_SIZE * GROUP_STRIDE + LINE_SIZE) + index % GROUP_SIZE;
+    }
+
+    static PoolItemMeta& meta(uint8_t* groups, size_t index) {
+        return ((PoolItemMeta*)(groups + index / GROUP_SIZE * GROUP_STRIDE))[index % GROUP_SIZE];
+    }
+
+    static size_t indexOf(const uint8_t* groups, const PoolItem<T>* item) {
+        auto offset = (size_t)((const uint8_t*)item - groups);
+        return offset / GROUP_STRIDE * GROUP_SIZE + (offset % GROUP_STRIDE - LINE_SIZE) / sizeof(PoolItem<T>);
+    }
+};
+
+// Storage of a single pool item, padded to whole cache lines.
+template<typename T>
+struct alignas(std::hardware_destructive_interference_size) PoolItem {
+    static_assert(alignof(T) <= std::hardware_destructive_interference_size, "unsupported item alignment");
 
 private:
     std::array<uint8_t, sizeof(T)> itemData;
@@ -19,14 +92,18 @@ public:
         return (T*)itemData.data();
     }
 
+    // N.B. The item may belong to a pool of a type derived from `T`, so the layout is read from the slab.
+    PoolItemMeta& meta() {
+        return PoolSlabHeader::fromAddress(this)->metaOf(this);
+    }
+
+    uint64_t version() {
+        return meta().version.load();
+    }
+
     static PoolItem<T>* fromData(const T* data) {
-        if (data == nullptr) {
-            return nullptr;
-        } else {
-            // N.B. This code assumes that `itemData` is the last property.
-            static constexpr size_t offset = sizeof(PoolItem<T>) - sizeof(T);
-            return (PoolItem<T>*)((size_t)data - offset);
-        }
+        // N.B. This code assumes that `itemData` is the only property.
+        return (PoolItem<T>*)data;
     }
 };
 
@@ -40,7 +117,7 @@ public:
     explicit PoolItemHandle(PoolItem<T>* item = nullptr) {
         if (item != nullptr) {
             dataPtr = item->data();
-            version = item->version;
+            version = item->version();
         } else {
             dataPtr = nullptr;
             version = 0;
@@ -50,14 +127,14 @@ public:
     explicit PoolItemHandle(T* inDataPtr) {
         auto* item = PoolItem<T>::fromData(inDataPtr);
         dataPtr = inDataPtr;
-        version = item->version;
+        version = item->version();
     }
 
     bool valid() {
         if (dataPtr == nullptr) {
             return false;
         } else {
-            return item()->version == version;
+            return item()->version() == version;
         }
     }
 
@@ -73,6 +150,33 @@ public:
         return valid();
     }
 
+    // Keeps the item from being reused until `unpin()`, or returns false if it has already been released. The
+    // item may still be released while pinned, which invalidates the handle, but it stays out of the free list.
+    bool pin() {
+        if (dataPtr == nullptr) {
+            return false;
+        }
+
+        // N.B. Both sequentially consistent, so that either the version is seen bumped here or a concurrent
+        // release sees the pin, see `PoolAllocator::release()`.
+        auto& meta = item()->meta();
+        meta.pins.fetch_add(1);
+        if (meta.version.load() == version) {
+            return true;
+        }
+
+        unpin();
+        return false;
+    }
+
+    void unpin() {
+        auto& meta = item()->meta();
+        auto pending = PoolItemMeta::RELEASE_PENDING;
+        if (meta.pins.fetch_sub(1) - 1 == pending && meta.pins.compare_exchange_strong(pending, 0u)) {
+            PoolSlabHeader::fromAddress(dataPtr)->recycleItem(dataPtr);
+        }
+    }
+
     T* operator*() {
         return dataPtr;
     }
@@ -82,80 +186,331 @@ public:
     }
 };
 
+// Lock-free pool that grows by allocating additional slabs of `slabSize` items when it runs out, up to an
+// optional maximum capacity. Slabs are only freed when the pool is destroyed, so items never move.
+//
+// A pool can be owned by a single thread, which then is the only one allowed to obtain items. The owner keeps
+// free items in a plain local list, so it obtains and releases without atomic read-modify-writes, while other
+// threads push the items they release to a separate stack that the owner takes over in one go once the local
+// list runs dry. Pools without an owner share a single free list between all threads.
 template<typename T>
 class PoolAllocator {
+public:
+    static constexpr size_t UNBOUNDED = 0u;
+    static constexpr size_t MAX_SLAB_COUNT = 1024u;
+
 private:
-    std::vector<PoolItem<T>> items;
-    std::atomic<PoolItem<T>*> next;
-    size_t currSize = 0;
+    static constexpr uint32_t NO_ITEM = UINT32_MAX;
+
+    std::array<std::atomic<PoolSlabHeader*>, MAX_SLAB_COUNT> slabs;
+    // Free list head of pools without an owner, the index of the first free item in the lower 32 bits and a
+    // generation counter in the upper 32 bits. The generation changes on every push and pop, so a pop that read
+    // a stale `nextFree` after the head was popped and pushed back by other threads fails its CAS instead of
+    // corrupting the list.
+    std::atomic<uint64_t> head;
+    // Items released by threads other than the owner. The owner only ever takes the whole stack, so pushes
+    // don't need a generation counter.
+    alignas(std::hardware_destructive_interference_size) std::atomic<uint32_t> remoteHead;
+    // Number of free items in `head` or `remoteHead`.
+    std::atomic<size_t> sharedSize;
+    alignas(std::hardware_destructive_interference_size) uint32_t localHead;
+    // Only written by the owner, atomic so that `size()` can be called from any thread.
+    std::atomic<size_t> localSize;
+    std::thread::id ownerThread;
+    std::atomic<size_t> slabCount;
+    std::atomic<size_t> growCount;
+    std::mutex growMutex;
+    size_t slabSize;
+    uint32_t slabShift;
     size_t maxCapacity;
 
+    static uint64_t pack(uint32_t index, uint32_t generation) {
+        return ((uint64_t)generation << 32u) | index;
+    }
+
+    static uint32_t indexOf(uint64_t tagged) {
+        return (uint32_t)tagged;
+    }
+
+    static uint32_t generationOf(uint64_t tagged) {
+        return (uint32_t)(tagged >> 32u);
+    }
+
+    using Layout = PoolSlabLayout<T>;
+
+    PoolItem<T>* itemAt(uint32_t index) {
+        auto* slab = slabs[index >> slabShift].load(std::memory_order_relaxed);
+        return Layout::item(slab->groups, index & (slabSize - 1));
+    }
+
+    PoolItemMeta& metaAt(uint32_t index) {
+        auto* slab = slabs[index >> slabShift].load(std::memory_order_relaxed);
+        return Layout::meta(slab->groups, index & (slabSize - 1));
+    }
+
+    static uint32_t poolIndexOf(PoolItem<T>* item) {
+        auto* slab = PoolSlabHeader::fromAddress(item);
+        return slab->firstIndex + (uint32_t)Layout::indexOf(slab->groups, item);
+    }
+
+    bool hasOwner() const {
+        return ownerThread != std::thread::id();
+    }
+
+    bool isOwner() const {
+        return ownerThread == std::this_thread::get_id();
+    }
+
+    // Allocates a new slab and adds its items to the free list, returns false if the pool can't grow.
+    bool grow() {
+        std::lock_guard lock { growMutex };
+
+        // Another thread has grown the pool or released items in the meantime.
+        if (!hasOwner() && indexOf(head.load(std::memory_order_acquire)) != NO_ITEM) {
+            return true;
+        }
+
+        auto slabIndex = slabCount.load(std::memory_order_relaxed);
+        if (slabIndex == MAX_SLAB_COUNT
+            || (maxCapacity != UNBOUNDED && (slabIndex + 1) * slabSize > maxCapacity)) {
+            return false;
+        }
+
+        auto* block = (uint8_t*)::operator new(Layout::slabBytes(slabSize),
+            std::align_val_t(PoolSlabHeader::ALIGNMENT));
+        auto firstIndex = (uint32_t)(slabIndex * slabSize);
+
+        auto* slab = new(block)PoolSlabHeader {};
+        slab->pool = this;
+        slab->releaseItem = [](void* item) {
+            auto* poolItem = (PoolItem<T>*)item;
+            fromItem(poolItem)->release(poolItem);
+        };
+        slab->recycleItem = [](void* item) {
+            auto* poolItem = (PoolItem<T>*)item;
+            fromItem(poolItem)->recycle(poolItem);
+        };
+        slab->groups = block + sizeof(PoolSlabHeader);
+        slab->firstIndex = firstIndex;
+        slab->itemCount = (uint32_t)slabSize;
+        slab->itemStride = sizeof(PoolItem<T>);
+        slab->groupStride = Layout::GROUP_STRIDE;
+
+        for (auto i = 0u; i < slabSize; i++) {
+            auto* meta = new(&Layout::meta(slab->groups, i))PoolItemMeta {};
+            meta->nextFree.store(firstIndex + i + 1, std::memory_order_relaxed);
+        }
+
+        slabs[slabIndex].store(slab, std::memory_order_relaxed);
+        slabCount.store(slabIndex + 1, std::memory_order_relaxed);
+        growCount.fetch_add(1, std::memory_order_relaxed);
+
+        auto& last = Layout::meta(slab->groups, slabSize - 1);
+        if (hasOwner()) {
+            // Only the owner obtains items, so the local list is empty.
+            last.nextFree.store(NO_ITEM, std::memory_order_relaxed);
+            localHead = firstIndex;
+            localSize.store(slabSize, std::memory_order_relaxed);
+            return true;
+        }
+
+        sharedSize.fetch_add(slabSize, std::memory_order_relaxed);
+
+        // Other threads may have released items since the check above, so the slab is spliced in front of them.
+        uint64_t oldHead = head.load(std::memory_order_relaxed);
+        do {
+            last.nextFree.store(indexOf(oldHead), std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(oldHead, pack(firstIndex, generationOf(oldHead) + 1),
+            std::memory_order_release, std::memory_order_relaxed));
+
+        return true;
+    }
+
+    PoolItem<T>* obtainLocal() {
+        if (localHead == NO_ITEM) {
+            // Take over everything released by other threads so far.
+            localHead = remoteHead.exchange(NO_ITEM, std::memory_order_acquire);
+
+            size_t count = 0;
+            for (auto index = localHead; index != NO_ITEM;) {
+                index = metaAt(index).nextFree.load(std::memory_order_relaxed);
+                count++;
+            }
+
+            if (count > 0) {
+                sharedSize.fetch_sub(count, std::memory_order_relaxed);
+                localSize.store(count, std::memory_order_relaxed);
+            }
+
+            if (localHead == NO_ITEM && !grow()) {
+                return nullptr;
+            }
+        }
+
+        auto* item = itemAt(localHead);
+        localHead = metaAt(localHead).nextFree.load(std::memory_order_relaxed);
+        localSize.store(localSize.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+        return item;
+    }
+
+    PoolItem<T>* obtainShared() {
+        uint64_t oldHead = head.load(std::memory_order_acquire);
+        do {
+            auto index = indexOf(oldHead);
+            if (index == NO_ITEM) {
+                if (!grow()) {
+                    return nullptr;
+                }
+
+                oldHead = head.load(std::memory_order_acquire);
+                continue;
+            }
+
+            auto newHead = pack(metaAt(index).nextFree.load(std::memory_order_relaxed), generationOf(oldHead) + 1);
+            if (head.compare_exchange_weak(oldHead, newHead, std::memory_order_acquire, std::memory_order_acquire)) {
+                sharedSize.fetch_sub(1, std::memory_order_relaxed);
+                return itemAt(index);
+            }
+        } while (true);
+    }
+
 public:
-    explicit PoolAllocator(size_t inSize)
-        :items { inSize }, maxCapacity { inSize } {
-        assert(inSize > 0);
+    // `inSlabSize` must be a power of two. The pool starts with one slab and never holds more than
+    // `inMaxCapacity` items unless that is `UNBOUNDED`.
+    explicit PoolAllocator(size_t inSlabSize, size_t inMaxCapacity = UNBOUNDED)
+        :slabs {}, head { pack(NO_ITEM, 0) }, remoteHead { NO_ITEM }, sharedSize { 0 }, localHead { NO_ITEM },
+         localSize { 0 }, ownerThread {}, slabCount { 0 }, growCount { 0 }, slabSize { inSlabSize }, slabShift { 0 },
+         maxCapacity { inMaxCapacity } {
+        assert(inSlabSize > 0 && (inSlabSize & (inSlabSize - 1)) == 0);
+        assert(inMaxCapacity == UNBOUNDED || inMaxCapacity >= inSlabSize);
+        assert(inSlabSize * MAX_SLAB_COUNT < NO_ITEM);
+        assert(Layout::slabBytes(inSlabSize) <= PoolSlabHeader::ALIGNMENT);
 
-        for (auto i = 0u; i < inSize - 1; i++) {
-            items[i].next = &items[i + 1];
-            currSize++;
+        while (((size_t)1 << slabShift) < slabSize) {
+            slabShift++;
         }
 
-        currSize++;
-        next = &items[0];
+        grow();
+
+        // Only growth beyond the initial slab is counted.
+        growCount = 0;
+    }
+
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+    ~PoolAllocator() {
+        for (auto i = 0u; i < slabCount; i++) {
+            ::operator delete(slabs[i].load(std::memory_order_relaxed), std::align_val_t(PoolSlabHeader::ALIGNMENT));
+        }
+    }
+
+    // Makes `thread` the only thread allocating from the pool. Must be called before any items are obtained.
+    void setOwner(std::thread::id thread) {
+        assert(size() == capacity());
+
+        ownerThread = thread;
+        if (hasOwner()) {
+            localHead = indexOf(head.exchange(pack(NO_ITEM, 0), std::memory_order_relaxed));
+            localSize.store(sharedSize.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        }
     }
 
     template<typename ...Args>
     [[nodiscard]]
     PoolItem<T>* obtain(Args&& ...args) {
-        PoolItem<T>* item;
-        do {
-            item = next;
-            if (item == nullptr) {
-                return nullptr;
-            }
-        } while (!next.compare_exchange_strong(item, (PoolItem<T>*)item->next));
-        currSize--;
+        assert(!hasOwner() || isOwner());
 
-        item->next = this;
-        new(item->data())T(std::forward<Args>(args)...);
+        auto* item = hasOwner() ? obtainLocal() : obtainShared();
+        if (item != nullptr) {
+            new(item->data())T(std::forward<Args>(args)...);
+        }
 
         return item;
     }
 
     void release(PoolItemHandle<T>& handle) {
         assert(handle.valid());
-        assert((void*)&items.front() <= handle.data());
-        assert((void*)(&items.back() + sizeof(T)) >= handle.data());
+        assert(fromItem(handle.item()) == this);
 
         release(handle.item());
     }
 
     void release(PoolItem<T>* item) {
         item->data()->~T();
-        item->version++;
 
-        PoolItem<T>* oldNext;
-        do {
-            oldNext = next;
-            item->next = oldNext;
-        } while (!next.compare_exchange_strong(oldNext, item));
+        auto& meta = item->meta();
+        // N.B. Must stay sequentially consistent, `TaskGraph::notifyCompletion()` relies on it being ordered
+        // before the waiter check, and `PoolItemHandle::pin()` on it being ordered before the pin check.
+        meta.version++;
 
-        currSize++;
+        // Pinned items are left for the last pin to recycle.
+        auto pins = meta.pins.load();
+        while (pins != 0) {
+            if (meta.pins.compare_exchange_weak(pins, pins | PoolItemMeta::RELEASE_PENDING)) {
+                return;
+            }
+        }
+
+        recycle(item);
+    }
+
+    // Puts a released item back on the free list.
+    void recycle(PoolItem<T>* item) {
+        auto index = poolIndexOf(item);
+        auto& meta = metaAt(index);
+
+        if (hasOwner()) {
+            if (isOwner()) {
+                meta.nextFree.store(localHead, std::memory_order_relaxed);
+                localHead = index;
+                localSize.store(localSize.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+
+            // Counted before the item is pushed, so that the owner taking it over can't decrement the size
+            // below zero.
+            sharedSize.fetch_add(1, std::memory_order_relaxed);
+
+            uint32_t oldHead = remoteHead.load(std::memory_order_relaxed);
+            do {
+                meta.nextFree.store(oldHead, std::memory_order_relaxed);
+            } while (!remoteHead.compare_exchange_weak(oldHead, index, std::memory_order_release,
+                std::memory_order_relaxed));
+
+            return;
+        }
+
+        sharedSize.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t oldHead = head.load(std::memory_order_relaxed);
+        do {
+            meta.nextFree.store(indexOf(oldHead), std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(oldHead, pack(index, generationOf(oldHead) + 1),
+            std::memory_order_release, std::memory_order_relaxed));
     }
 
+    // Number of free items.
     [[nodiscard]] size_t size() const {
-        return currSize;
+        return localSize.load(std::memory_order_relaxed) + sharedSize.load(std::memory_order_relaxed);
     }
 
+    // Number of items in all allocated slabs.
     [[nodiscard]] size_t capacity() const {
-        return maxCapacity;
+        return slabCount.load(std::memory_order_relaxed) * slabSize;
+    }
+
+    // Number of times the pool had to allocate a slab after construction.
+    [[nodiscard]] size_t growthCount() const {
+        return growCount.load(std::memory_order_relaxed);
     }
 
     static PoolAllocator<T>* fromItem(PoolItem<T>* item) {
         if (item == nullptr) {
             return nullptr;
         } else {
-            return (PoolAllocator<T>*)item->next;
+            return (PoolAllocator<T>*)PoolSlabHeader::fromAddress(item)->pool;
         }
     }
-};
\ No newline at end of file
+};
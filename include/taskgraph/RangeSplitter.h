@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include "TaskGraph.h"
+
+// Splits index ranges between tasks with lazy binary splitting. A task working on a range spawns a subtask for
+// half of it only while its worker has no tasks of its own left that idle workers could steal, and otherwise
+// works through the range one chunk at a time. Loops which keep every worker busy are barely split, while
+// skewed loops keep being split wherever there's work left.
+class RangeSplitter {
+public:
+    // Automatic grain sizes split loops into at least this many chunks per worker.
+    static constexpr size_t CHUNKS_PER_WORKER = 64u;
+
+    static bool shouldSplit() {
+        auto* worker = Worker::getThreadWorker();
+        return worker == nullptr || !worker->hasLocalTasks();
+    }
+
+    // Ranges of at most the returned size are never split, a `grainSize` of 0 picks a size from the number of
+    // workers.
+    static size_t getGrainSize(size_t count, size_t grainSize) {
+        if (grainSize > 0) {
+            return grainSize;
+        }
+
+        auto* taskGraph = TaskGraph::get();
+        auto workerCount = taskGraph != nullptr ? taskGraph->workers.size() : 1u;
+        return std::max<size_t>(count / (workerCount * CHUNKS_PER_WORKER), 1u);
+    }
+
+    // Works through `[begin, end)` by calling `fn(chunkBegin, chunkEnd)` on chunks of it, and `spawn(middle, end)`
+    // whenever the upper half of what's left should be handed off to a subtask. `Iterator` may be an integer or a
+    // random access iterator.
+    template<typename Iterator, typename F, typename S>
+    static void split(Iterator begin, Iterator end, size_t grainSize, F&& fn, S&& spawn) {
+        if (!(begin < end)) {
+            return;
+        }
+
+        while ((size_t)(end - begin) > grainSize) {
+            if (!shouldSplit()) {
+                fn(begin, begin + grainSize);
+                begin += grainSize;
+                continue;
+            }
+
+            Iterator middle = begin + (end - begin) / 2;
+            spawn(middle, end);
+            end = middle;
+        }
+
+        fn(begin, end);
+    }
+
+    // Calls `fn(chunkBegin, chunkEnd)` for chunks covering `[begin, end)`, spawning subtasks of `task` for the
+    // parts of the range which are split off. `fn` is copied into every subtask, so it should be small, such as a
+    // lambda referencing state stored in the payload of `task`.
+    template<typename Iterator, typename F>
+    static void forEachChunk(Task& task, Iterator begin, Iterator end, size_t grainSize, const F& fn) {
+        split(begin, end, grainSize, fn, [&](Iterator middle, Iterator last) {
+            auto parent = PoolItemHandle<Task>(&task);
+            TaskGraph::allocate([middle, last, grainSize, fn](Task& subtask) {
+                forEachChunk(subtask, middle, last, grainSize, fn);
+            }, &parent)->submit();
+        });
+    }
+};
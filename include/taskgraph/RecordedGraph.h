@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "PoolAllocator.h"
+
+class Task;
+
+// Graph of tasks which is recorded once and then run any number of times. Recording stores the callables and
+// edges, the first run after recording compiles them into arrays in topological order with precomputed
+// in-degrees, and every run after that only has to reset the counters of pending predecessors and spawn the
+// tasks. Like with `tasks::after`, a node is only run once its predecessors and all of their subtasks have
+// finished. A graph can't be run again before its previous run has finished.
+class RecordedGraph {
+public:
+    using Node = uint32_t;
+
+private:
+    struct NodeFn {
+        void (*invoke)(void* data, Task& task);
+        void (*destroy)(void* data);
+        void* data;
+    };
+
+    struct CompiledNode {
+        NodeFn fn;
+        uint32_t successorBegin;
+        uint32_t successorEnd;
+        uint32_t inDegree;
+    };
+
+    // Payload of the task running a node. Successors are released when the payload is destroyed, which is once
+    // the node and all of its subtasks have finished.
+    class NodeTaskFn {
+    private:
+        RecordedGraph* graph;
+        uint32_t index;
+
+    public:
+        NodeTaskFn(RecordedGraph* inGraph, uint32_t inIndex);
+        NodeTaskFn(NodeTaskFn&& other) noexcept;
+        ~NodeTaskFn();
+
+        NodeTaskFn(const NodeTaskFn&) = delete;
+        NodeTaskFn& operator=(const NodeTaskFn&) = delete;
+
+        void operator()(Task& task);
+    };
+
+    static constexpr size_t STORAGE_CHUNK_SIZE = 4096u;
+
+    // Callables are stored in chunks which never move, so they don't need to be movable once recorded.
+    std::vector<std::unique_ptr<std::max_align_t[]>> storage;
+    size_t storageUsed;
+    std::vector<NodeFn> functions;
+    std::vector<std::pair<Node, Node>> edges;
+
+    bool compiled;
+    std::vector<CompiledNode> nodes;
+    std::vector<uint32_t> successors;
+    std::vector<uint32_t> roots;
+    std::unique_ptr<std::atomic<uint32_t>[]> pendingCounts;
+    // Root task of the current run, which every task of the run is a subtask of.
+    Task* runTask;
+
+    void* allocateStorage(size_t size, size_t alignment);
+    Node addNode(NodeFn fn);
+    void compile();
+    void spawn(Task& parent, uint32_t index);
+    void releaseSuccessors(uint32_t index);
+
+public:
+    RecordedGraph();
+    ~RecordedGraph();
+
+    RecordedGraph(const RecordedGraph&) = delete;
+    RecordedGraph& operator=(const RecordedGraph&) = delete;
+
+    template<typename T>
+    Node add(T&& taskFn) {
+        using Fn = std::decay_t<T>;
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "over-aligned callables aren't supported");
+
+        void* data = new(allocateStorage(sizeof(Fn), alignof(Fn))) Fn(std::forward<T>(taskFn));
+        return addNode({
+            [](void* data, Task& task) {
+                (*(Fn*)data)(task);
+            },
+            [](void* data) {
+                ((Fn*)data)->~Fn();
+            },
+            data
+        });
+    }
+
+    template<typename T>
+    Node after(std::initializer_list<Node> predecessors, T&& taskFn) {
+        auto node = add(std::forward<T>(taskFn));
+        for (auto predecessor : predecessors) {
+            precede(predecessor, node);
+        }
+
+        return node;
+    }
+
+    void precede(Node predecessor, Node successor);
+    [[nodiscard]] size_t size() const;
+
+    // Submits the graph, the returned task finishes once all tasks of the graph have. Throws `std::logic_error`
+    // without running anything if the recorded edges form a cycle.
+    PoolItemHandle<Task> run();
+};
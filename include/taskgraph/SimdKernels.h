@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Vectorized leaf kernels summing and prefix summing contiguous arrays of arithmetic values. AVX2 kernels are
+// used when compiling with AVX2 enabled (see `TASKGRAPH_EnableAVX2`), SSE2 kernels on other x86-64 targets and
+// plain loops everywhere else. Floating point sums are reassociated, so they may round differently than a
+// sequential sum would.
+class SimdKernels {
+public:
+    template<typename T>
+    static constexpr bool isSupported() {
+        return std::is_same_v<T, float> || std::is_same_v<T, double> || std::is_same_v<T, int32_t>
+            || std::is_same_v<T, uint32_t> || std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t>;
+    }
+
+    // Whether `Iterator` points into a contiguous array of `T`.
+    template<typename Iterator, typename T>
+    static constexpr bool isContiguous() {
+        return std::is_same_v<Iterator, T*> || std::is_same_v<Iterator, const T*>
+            || std::is_same_v<Iterator, typename std::vector<T>::iterator>
+            || std::is_same_v<Iterator, typename std::vector<T>::const_iterator>;
+    }
+
+    // Whether folding `T` values with `Op` is a sum these kernels can compute.
+    template<typename Op, typename T>
+    static constexpr bool isSum() {
+        return isSupported<T>() && (std::is_same_v<Op, std::plus<T>> || std::is_same_v<Op, std::plus<>>);
+    }
+
+    template<typename T>
+    static T sum(const T* data, size_t count, T init) {
+        static_assert(isSupported<T>(), "unsupported type");
+
+        size_t i = 0;
+#if defined(__AVX2__)
+        if constexpr (std::is_same_v<T, float>) {
+            __m256 a = _mm256_setzero_ps(), b = _mm256_setzero_ps();
+            for (; i + 16 <= count; i += 16) {
+                a = _mm256_add_ps(a, _mm256_loadu_ps(data + i));
+                b = _mm256_add_ps(b, _mm256_loadu_ps(data + i + 8));
+            }
+
+            init += horizontalSum(_mm_add_ps(_mm256_castps256_ps128(_mm256_add_ps(a, b)),
+                _mm256_extractf128_ps(_mm256_add_ps(a, b), 1)));
+        } else if constexpr (std::is_same_v<T, double>) {
+            __m256d a = _mm256_setzero_pd(), b = _mm256_setzero_pd();
+            for (; i + 8 <= count; i += 8) {
+                a = _mm256_add_pd(a, _mm256_loadu_pd(data + i));
+                b = _mm256_add_pd(b, _mm256_loadu_pd(data + i + 4));
+            }
+
+            init += horizontalSum(_mm_add_pd(_mm256_castpd256_pd128(_mm256_add_pd(a, b)),
+                _mm256_extractf128_pd(_mm256_add_pd(a, b), 1)));
+        } else {
+            __m256i a = _mm256_setzero_si256();
+            for (; i + 32 / sizeof(T) <= count; i += 32 / sizeof(T)) {
+                auto values = _mm256_loadu_si256((const __m256i*)(data + i));
+                a = sizeof(T) == 4 ? _mm256_add_epi32(a, values) : _mm256_add_epi64(a, values);
+            }
+
+            init += horizontalSum<T>(sizeof(T) == 4
+                ? _mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1))
+                : _mm_add_epi64(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1)));
+        }
+#elif defined(__SSE2__)
+        if constexpr (std::is_same_v<T, float>) {
+            __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+            for (; i + 8 <= count; i += 8) {
+                a = _mm_add_ps(a, _mm_loadu_ps(data + i));
+                b = _mm_add_ps(b, _mm_loadu_ps(data + i + 4));
+            }
+
+            init += horizontalSum(_mm_add_ps(a, b));
+        } else if constexpr (std::is_same_v<T, double>) {
+            __m128d a = _mm_setzero_pd(), b = _mm_setzero_pd();
+            for (; i + 4 <= count; i += 4) {
+                a = _mm_add_pd(a, _mm_loadu_pd(data + i));
+                b = _mm_add_pd(b, _mm_loadu_pd(data + i + 2));
+            }
+
+            init += horizontalSum(_mm_add_pd(a, b));
+        } else {
+            __m128i a = _mm_setzero_si128();
+            for (; i + 16 / sizeof(T) <= count; i += 16 / sizeof(T)) {
+                auto values = _mm_loadu_si128((const __m128i*)(data + i));
+                a = sizeof(T) == 4 ? _mm_add_epi32(a, values) : _mm_add_epi64(a, values);
+            }
+
+            init += horizontalSum<T>(a);
+        }
+#endif
+
+        for (; i < count; i++) {
+            init += data[i];
+        }
+
+        return init;
+    }
+
+    // Writes the inclusive prefix sums of `input` plus `offset` to `output`, which may be the same array, and
+    // returns the last of them.
+    template<typename T>
+    static T inclusiveScan(const T* input, T* output, size_t count, T offset) {
+        static_assert(isSupported<T>(), "unsupported type");
+
+        size_t i = 0;
+#if defined(__AVX2__)
+        if constexpr (sizeof(T) == 4) {
+            // Prefix sums within both 128-bit lanes, then the sum of the lower lane is carried into the upper one.
+            auto carry = _mm256_broadcastsi128_si256(broadcast(offset));
+            for (; i + 8 <= count; i += 8) {
+                auto x = _mm256_loadu_si256((const __m256i*)(input + i));
+                x = add<T>(x, _mm256_slli_si256(x, 4));
+                x = add<T>(x, _mm256_slli_si256(x, 8));
+                auto lower = _mm256_permute2x128_si256(_mm256_shuffle_epi32(x, 0xFF), x, 0x08);
+                x = add<T>(add<T>(x, lower), carry);
+                _mm256_storeu_si256((__m256i*)(output + i), x);
+                carry = _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(7));
+            }
+
+            offset = i > 0 ? output[i - 1] : offset;
+        }
+#endif
+#if defined(__SSE2__)
+        {
+            auto carry = broadcast(offset);
+            for (; i + 16 / sizeof(T) <= count; i += 16 / sizeof(T)) {
+                auto x = _mm_loadu_si128((const __m128i*)(input + i));
+                x = add<T>(x, _mm_slli_si128(x, sizeof(T)));
+                if constexpr (sizeof(T) == 4) {
+                    x = add<T>(x, _mm_slli_si128(x, 8));
+                }
+
+                x = add<T>(x, carry);
+                _mm_storeu_si128((__m128i*)(output + i), x);
+                carry = sizeof(T) == 4 ? _mm_shuffle_epi32(x, 0xFF) : _mm_shuffle_epi32(x, 0xEE);
+            }
+
+            offset = i > 0 ? output[i - 1] : offset;
+        }
+#endif
+
+        for (; i < count; i++) {
+            offset += input[i];
+            output[i] = offset;
+        }
+
+        return offset;
+    }
+
+private:
+#if defined(__SSE2__)
+    static float horizontalSum(__m128 x) {
+        x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+        x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+        return _mm_cvtss_f32(x);
+    }
+
+    static double horizontalSum(__m128d x) {
+        return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x)));
+    }
+
+    template<typename T>
+    static T horizontalSum(__m128i x) {
+        alignas(16) T lanes[16 / sizeof(T)];
+        _mm_store_si128((__m128i*)lanes, x);
+
+        T sum = 0;
+        for (auto lane : lanes) {
+            sum += lane;
+        }
+
+        return sum;
+    }
+
+    template<typename T>
+    static __m128i broadcast(T value) {
+        if constexpr (sizeof(T) == 4) {
+            int32_t bits;
+            __builtin_memcpy(&bits, &value, sizeof(bits));
+            return _mm_set1_epi32(bits);
+        } else {
+            int64_t bits;
+            __builtin_memcpy(&bits, &value, sizeof(bits));
+            return _mm_set1_epi64x(bits);
+        }
+    }
+
+    // Lane-wise addition of vectors of `T`, reinterpreted as integer vectors.
+    template<typename T>
+    static __m128i add(__m128i a, __m128i b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b)));
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm_castpd_si128(_mm_add_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b)));
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm_add_epi32(a, b);
+        } else {
+            return _mm_add_epi64(a, b);
+        }
+    }
+#endif
+
+#if defined(__AVX2__)
+    template<typename T>
+    static __m256i add(__m256i a, __m256i b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_castps_si256(_mm256_add_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b)));
+        } else {
+            return _mm256_add_epi32(a, b);
+        }
+    }
+#endif
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Chunked bump allocator for task payloads too large to be stored inline. Only the thread owning the arena
+// allocates from it, while allocations can be freed from any thread. Every chunk counts its live allocations,
+// and once the owner has moved on to another chunk and the count drops to zero, the chunk is handed back to
+// the arena to be reused. Chunks are aligned to their size, so an allocation finds its chunk by masking its
+// address.
+class TaskArena {
+public:
+    static constexpr size_t CHUNK_SIZE = 64u * 1024u;
+
+private:
+    struct alignas(std::hardware_destructive_interference_size) Chunk {
+        // Live allocations, plus one while the owner is still allocating from the chunk.
+        std::atomic<uint32_t> liveCount;
+        // Chunks holding a single allocation larger than `CHUNK_SIZE` are freed instead of reused.
+        bool dedicated;
+        size_t capacity;
+        size_t used;
+        TaskArena* arena;
+        Chunk* next;
+
+        uint8_t* data() {
+            return (uint8_t*)(this + 1);
+        }
+    };
+
+    Chunk* current;
+    // Free chunks, only accessed by the owner.
+    Chunk* freeChunks;
+    // Chunks freed by other threads, taken over by the owner all at once.
+    alignas(std::hardware_destructive_interference_size) std::atomic<Chunk*> remoteFreeChunks;
+    std::vector<Chunk*> chunks;
+
+    Chunk* obtainChunk();
+    static void retire(Chunk* chunk);
+    static Chunk* createChunk(size_t capacity, bool dedicated, TaskArena* arena);
+
+public:
+    TaskArena();
+    ~TaskArena();
+
+    TaskArena(const TaskArena&) = delete;
+    TaskArena& operator=(const TaskArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment);
+    static void free(void* data);
+
+    // Number of chunks of `CHUNK_SIZE` allocated so far.
+    [[nodiscard]] size_t chunkCount() const;
+};
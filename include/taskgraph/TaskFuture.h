@@ -0,0 +1,239 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include "TaskGraph.h"
+
+template<typename R>
+class TaskFuture;
+
+// Result type of a task callable, the result of `void` callables is an empty value.
+template<typename Fn>
+using TaskResult = std::decay_t<std::invoke_result_t<Fn&, Task&>>;
+
+// State shared by a future and the task producing its result. It's stored in a `TaskBox`, so results small
+// enough to be stored inline don't need to be heap allocated.
+template<typename R>
+class FutureState {
+private:
+    using Value = std::conditional_t<std::is_void_v<R>, std::monostate, R>;
+
+    // One reference held by the future and one by the producing task.
+    std::atomic<uint32_t> refCount { 2 };
+    // Task to submit once the result is complete, or `completed()` if it already is.
+    std::atomic<Task*> continuation { nullptr };
+
+    static Task* completed() {
+        return reinterpret_cast<Task*>(alignof(Task));
+    }
+
+public:
+    std::optional<Value> value;
+
+    static Task* create() {
+        return TaskBox<FutureState>::create();
+    }
+
+    static FutureState& of(Task* box) {
+        return TaskBox<FutureState>::get(box);
+    }
+
+    static void release(Task* box) {
+        if (--of(box).refCount == 0) {
+            TaskBox<FutureState>::destroy(box);
+        }
+    }
+
+    void complete() {
+        auto* task = continuation.exchange(completed(), std::memory_order_acq_rel);
+        if (task != nullptr) {
+            task->submit();
+        }
+    }
+
+    void setContinuation(Task* task) {
+        Task* expected = nullptr;
+        if (!continuation.compare_exchange_strong(expected, task, std::memory_order_acq_rel)) {
+            // The result is already complete.
+            task->submit();
+        }
+    }
+};
+
+// Payload of a task producing the result of a future.
+template<typename Fn, typename R>
+class AsyncTaskFn {
+private:
+    Fn fn;
+    Task* stateBox;
+
+public:
+    template<typename T>
+    AsyncTaskFn(T&& inFn, Task* inStateBox)
+        :fn(std::forward<T>(inFn)), stateBox { inStateBox } {
+    }
+
+    AsyncTaskFn(AsyncTaskFn&& other) noexcept
+        :fn(std::move(other.fn)), stateBox { std::exchange(other.stateBox, nullptr) } {
+    }
+
+    AsyncTaskFn(const AsyncTaskFn&) = delete;
+    AsyncTaskFn& operator=(const AsyncTaskFn&) = delete;
+
+    // N.B. Payloads are destroyed once their task and all of its subtasks have finished, which is when the
+    // result is complete.
+    ~AsyncTaskFn() {
+        if (stateBox != nullptr) {
+            FutureState<R>::of(stateBox).complete();
+            FutureState<R>::release(stateBox);
+        }
+    }
+
+    void operator()(Task& task) {
+        auto& state = FutureState<R>::of(stateBox);
+        if constexpr (std::is_void_v<R>) {
+            fn(task);
+            state.value.emplace();
+        } else {
+            state.value.emplace(fn(task));
+        }
+    }
+};
+
+// Callable of a continuation, receiving the result of the future it was attached to.
+template<typename Fn, typename S>
+class ContinuationFn {
+private:
+    Fn fn;
+    Task* sourceBox;
+
+public:
+    template<typename T>
+    ContinuationFn(T&& inFn, Task* inSourceBox)
+        :fn(std::forward<T>(inFn)), sourceBox { inSourceBox } {
+    }
+
+    ContinuationFn(ContinuationFn&& other) noexcept
+        :fn(std::move(other.fn)), sourceBox { std::exchange(other.sourceBox, nullptr) } {
+    }
+
+    ContinuationFn(const ContinuationFn&) = delete;
+    ContinuationFn& operator=(const ContinuationFn&) = delete;
+
+    ~ContinuationFn() {
+        if (sourceBox != nullptr) {
+            FutureState<S>::release(sourceBox);
+        }
+    }
+
+    decltype(auto) operator()(Task& task) {
+        if constexpr (std::is_void_v<S>) {
+            return fn(task);
+        } else {
+            return fn(task, std::move(*FutureState<S>::of(sourceBox).value));
+        }
+    }
+};
+
+// Handle to the result of a task, which is stored in a pooled slot until the future is released. Futures are
+// move-only, and have to be released before the task graph is shut down.
+template<typename R>
+class TaskFuture {
+    template<typename>
+    friend class TaskFuture;
+
+private:
+    PoolItemHandle<Task> task;
+    Task* stateBox = nullptr;
+
+    void reset() {
+        if (stateBox != nullptr) {
+            FutureState<R>::release(std::exchange(stateBox, nullptr));
+        }
+    }
+
+public:
+    TaskFuture() = default;
+
+    TaskFuture(TaskFuture&& other) noexcept
+        :task { other.task }, stateBox { std::exchange(other.stateBox, nullptr) } {
+    }
+
+    TaskFuture& operator=(TaskFuture&& other) noexcept {
+        if (this != &other) {
+            reset();
+            task = other.task;
+            stateBox = std::exchange(other.stateBox, nullptr);
+        }
+
+        return *this;
+    }
+
+    TaskFuture(const TaskFuture&) = delete;
+    TaskFuture& operator=(const TaskFuture&) = delete;
+
+    ~TaskFuture() {
+        reset();
+    }
+
+    // Allocates the task producing the result, without submitting it.
+    template<typename T>
+    static TaskFuture create(T&& inTaskFn, PoolItemHandle<Task>* parentTask,
+        TaskPriority priority = TaskPriority::Normal) {
+        return createWith([&](Task* stateBox) {
+            return AsyncTaskFn<std::decay_t<T>, R>(std::forward<T>(inTaskFn), stateBox);
+        }, parentTask, priority);
+    }
+
+    // Allocates a task with the payload returned by `makeTaskFn(stateBox)`, without submitting it. Instead of
+    // returning the result, the payload stores it in `FutureState<R>::of(stateBox)`, and then has to call
+    // `complete()` and `FutureState<R>::release()` once it's destroyed, like `AsyncTaskFn` does.
+    template<typename M>
+    static TaskFuture createWith(M&& makeTaskFn, PoolItemHandle<Task>* parentTask,
+        TaskPriority priority = TaskPriority::Normal) {
+        TaskFuture future;
+        future.stateBox = FutureState<R>::create();
+        future.task = TaskGraph::allocate(makeTaskFn(future.stateBox), parentTask, priority);
+        return future;
+    }
+
+    [[nodiscard]] bool valid() const {
+        return stateBox != nullptr;
+    }
+
+    // Whether the task producing the result, including its subtasks, has finished.
+    [[nodiscard]] bool ready() {
+        return valid() && !task.valid();
+    }
+
+    PoolItemHandle<Task>& getTask() {
+        return task;
+    }
+
+    // The result is complete once the task has finished, and may be read before the task is released, such as
+    // by its successors.
+    template<typename U = R>
+    std::enable_if_t<!std::is_void_v<U>, U&> get() {
+        assert(valid() && FutureState<R>::of(stateBox).value.has_value());
+        return *FutureState<R>::of(stateBox).value;
+    }
+
+    // Runs `fn(task, result)` once the result is complete, moving the result into it. The continuation takes
+    // over the result, which leaves this future invalid.
+    template<typename T>
+    auto then(T&& fn) {
+        assert(valid());
+
+        using Continuation = ContinuationFn<std::decay_t<T>, R>;
+        auto* sourceBox = std::exchange(stateBox, nullptr);
+        auto future = TaskFuture<TaskResult<Continuation>>::create(Continuation(std::forward<T>(fn), sourceBox),
+            nullptr);
+        FutureState<R>::of(sourceBox).setContinuation(*future.task);
+        return future;
+    }
+};
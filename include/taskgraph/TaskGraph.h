@@ -2,11 +2,28 @@
 
 #include <vector>
 #include <thread>
+#include <memory>
+#include <mutex>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <new>
 #include "Worker.h"
+#include "InjectionQueue.h"
 #include "PoolAllocator.h"
+#include "TaskPriority.h"
+#include "VictimSelector.h"
 
+class Task;
 class TaskGraph;
 
+// Operations on the payload of a task, there is one shared instance per payload type, see `TASK_OPS`.
+struct TaskOps {
+    void (*run)(Task&);
+    // Null for payloads which don't need to be torn down.
+    void (*destroy)(Task&);
+};
+
 namespace {
     std::unique_ptr<TaskGraph> gInstance;
 }
@@ -15,92 +32,205 @@ class Task {
     friend class TaskChainBuilder;
     friend class TaskGraph;
 
-public:
-    using TaskCallback = void (*)(Task&);
-
 private:
-    TaskCallback taskFn;
-    TaskCallback teardownFn = nullptr;
+    const TaskOps* ops;
     Task* parent;
-    Task* next;
-    std::atomic<size_t> childTaskCount;
-
+    // Successors to submit once the task has finished, see `precede()`.
+    std::atomic<Task*> next;
+    std::atomic<uint32_t> childTaskCount;
+    TaskPriority priority;
+    // Predecessors left to finish, plus one until the task is submitted.
+    std::atomic<uint16_t> dependencyCount;
+
+protected:
+    static constexpr size_t PAYLOAD_ALIGNMENT = alignof(void*);
     static constexpr size_t TASK_METADATA_SIZE =
-        sizeof(taskFn) + sizeof(teardownFn) + sizeof(parent) + sizeof(next) // NOLINT(bugprone-sizeof-expression)
-            + sizeof(childTaskCount);
+        (sizeof(ops) + sizeof(parent) + sizeof(next) + sizeof(childTaskCount) + sizeof(priority)
+            + sizeof(dependencyCount) + PAYLOAD_ALIGNMENT - 1) / PAYLOAD_ALIGNMENT * PAYLOAD_ALIGNMENT;
+
+public:
+    // Payload capacity of plain tasks, larger payloads are stored in `SizedTask` classes.
     static constexpr size_t TASK_PAYLOAD_SIZE = std::hardware_destructive_interference_size - TASK_METADATA_SIZE;
+    // Payload capacity of the largest task class, larger payloads are allocated on the heap.
+    static constexpr size_t MAX_TASK_PAYLOAD_SIZE =
+        MAX_TASK_LINE_COUNT * std::hardware_destructive_interference_size - TASK_METADATA_SIZE;
+
+    template<typename T>
+    static constexpr bool isPayloadInline() {
+        return sizeof(T) <= MAX_TASK_PAYLOAD_SIZE && alignof(T) <= PAYLOAD_ALIGNMENT;
+    }
+
+    template<typename T>
+    static constexpr bool isTeardownTrivial() {
+        return isPayloadInline<T>() && std::is_trivially_destructible_v<T>;
+    }
+
+    // Maximum number of predecessors of a single task, adding more throws `std::length_error`.
+    static constexpr size_t MAX_PREDECESSOR_COUNT = std::numeric_limits<uint16_t>::max() - 1;
+
+private:
+    // Successor lists link edges, tasks from the plain task pool which are never run and whose payload points
+    // to the successor. A successor which isn't reached through an edge, such as the next task of a chain, can
+    // only be the last one of the list.
+    static const TaskOps EDGE_OPS;
+
+    // Number of tasks `isNeededBy()` looks at before it gives up.
+    static constexpr size_t NEEDED_BY_SEARCH_LIMIT = 64u;
+
+    static Task* finishedSuccessors() {
+        return reinterpret_cast<Task*>(alignof(Task));
+    }
 
-    std::array<uint8_t, TASK_PAYLOAD_SIZE> payload;
+    // Allocates an edge to `successor`, which holds it back until the edge is linked or dropped.
+    static Task* createEdge(Task* successor);
+    // Releases an edge which was never linked, and the hold it has on its successor without submitting it.
+    static void cancelEdge(Task* edge);
+    // Releases an edge whose predecessor has already finished, along with the successor it held back.
+    static void dropEdge(Task* edge);
+    // Links `edge` to the task of `predecessor`, or drops it if that task has been released already.
+    static void link(PoolItemHandle<Task>& predecessor, Task* edge);
+    void link(Task* edge);
+
+    // N.B. The payload of `SizedTask` classes continues past the end of this array.
+    alignas(PAYLOAD_ALIGNMENT) std::array<uint8_t, TASK_PAYLOAD_SIZE> payload;
 
 public:
-    explicit Task(TaskCallback inTaskFn = nullptr, Task* parentTask = nullptr, Task* nextTask = nullptr);
+    explicit Task(const TaskOps* inOps = nullptr, Task* parentTask = nullptr, Task* nextTask = nullptr,
+        TaskPriority inPriority = TaskPriority::Normal);
 
     void run();
     void finish();
-    void setTeardownFunc(TaskCallback inTeardownFn);
-
+    // Holds back `successor`, which must not have been submitted yet, until this task has finished. Unlike
+    // parent handles, this task may already have finished as long as it hasn't been released, see the overload
+    // taking a handle for tasks which may have been.
+    void precede(Task* successor);
+    // Like `precede(successor)`, but the task of `predecessor` may have been released already, in which case
+    // there's nothing to wait for. It's pinned while the edge is linked, so its slot can't be reused meanwhile.
+    static void precede(PoolItemHandle<Task> predecessor, Task* successor);
+    // Like `precede(predecessor, successor)` for every one of `predecessors`, but either all of the edges are
+    // added or, if adding one throws, none of them are.
+    static void precede(std::initializer_list<PoolItemHandle<Task>> predecessors, Task* successor);
+    TaskPriority getPriority() const;
+    // Whether `task` can't finish before this task has, as it's this task, one of its ancestors, or a task held
+    // back by any of them, directly or through other tasks. Large graphs may not be searched in full, so this may
+    // miss some of them.
+    bool isNeededBy(const Task* task) const;
+
+    // N.B. Inline payloads must only be constructed in tasks of a class large enough to hold them, see
+    // `TaskClassFor`.
     template<typename T, typename... Args>
     void constructData(Args&& ... args) {
-        constexpr auto size = sizeof(T);
-
-        if constexpr (size <= TASK_PAYLOAD_SIZE) {
+        if constexpr (isPayloadInline<T>()) {
             new(payload.data())T(std::forward<Args>(args)...);
         } else {
-            *(T**)(payload.data()) = new T(std::forward<Args>(args)...);
+            auto* memory = Worker::allocatePayload(sizeof(T), alignof(T));
+            *(T**)(payload.data()) = new(memory)T(std::forward<Args>(args)...);
         }
     }
 
     template<typename T>
     void destroyData() {
-        constexpr auto size = sizeof(T);
-
-        if constexpr (size <= TASK_PAYLOAD_SIZE) {
+        if constexpr (isPayloadInline<T>()) {
             T* ptr = (T*)payload.data();
             ptr->~T();
         } else {
             T* ptr = *(T**)payload.data();
             ptr->~T();
+            TaskArena::free(ptr);
         }
     }
 
     template<typename T>
-    std::enable_if_t<!std::is_trivially_copyable_v<T>, const T&> getData() const {
-        constexpr auto size = sizeof(T);
-
-        if constexpr (size <= TASK_PAYLOAD_SIZE) {
+    T& getData() {
+        if constexpr (isPayloadInline<T>()) {
             return *(T*)payload.data();
         } else {
-            return *(T**)payload.data();
+            return **(T**)payload.data();
         }
     }
 
     template<typename T>
-    [[maybe_unused]]
-    std::enable_if_t<std::is_trivially_copyable_v<T> && (sizeof(T) <= TASK_PAYLOAD_SIZE)> setData(const T& data) {
-        memcpy(payload.data(), &data, sizeof(data));
+    const T& getData() const {
+        if constexpr (isPayloadInline<T>()) {
+            return *(const T*)payload.data();
+        } else {
+            return **(const T* const*)payload.data();
+        }
     }
 
     template<typename T>
-    std::enable_if_t<std::is_trivially_copyable_v<T> && (sizeof(T) <= TASK_PAYLOAD_SIZE), const T&> getData() const {
-        return *(T*)payload.data();
+    [[maybe_unused]]
+    std::enable_if_t<std::is_trivially_copyable_v<T> && (sizeof(T) <= TASK_PAYLOAD_SIZE)
+        && (alignof(T) <= PAYLOAD_ALIGNMENT)> setData(const T& data) {
+        memcpy(payload.data(), &data, sizeof(data));
     }
 
     PoolItemHandle<Task> submit();
 
 private:
     template<typename T>
-    Task* then(T inTaskFn, PoolItemHandle<Task>* parentTask) {
-        if (next == nullptr) {
-            next = *TaskGraph::allocate(inTaskFn, parentTask);
-        } else {
-            next->then(inTaskFn, parentTask);
-        }
+    Task* then(T&& inTaskFn, PoolItemHandle<Task>* parentTask);
 
-        return this;
-    }
 };
 
 static_assert(sizeof(Task) == std::hardware_destructive_interference_size, "invalid task size");
+static_assert(sizeof(PoolItem<Task>) == std::hardware_destructive_interference_size, "invalid pooled task size");
+
+template<typename T>
+inline constexpr TaskOps TASK_OPS {
+    [](Task& task) {
+        auto& taskFn = task.template getData<T>();
+        taskFn(task);
+    },
+    Task::isTeardownTrivial<T>() ? nullptr : +[](Task& task) {
+        task.template destroyData<T>();
+    }
+};
+
+// Task spanning `LineCount` cache lines, which leaves room for a larger payload than a plain `Task` has.
+template<size_t LineCount>
+class SizedTask : public Task {
+private:
+    std::array<uint8_t, (LineCount - 1) * std::hardware_destructive_interference_size> extraPayload;
+
+public:
+    static constexpr size_t PAYLOAD_SIZE = LineCount * std::hardware_destructive_interference_size - TASK_METADATA_SIZE;
+
+    using Task::Task;
+};
+
+// Smallest task class holding a payload of type `T` inline, or `Task` if the payload has to be heap allocated.
+template<typename T>
+using TaskClassFor = std::conditional_t<!Task::isPayloadInline<T>() || sizeof(T) <= Task::TASK_PAYLOAD_SIZE, Task,
+    std::conditional_t<sizeof(T) <= SizedTask<2>::PAYLOAD_SIZE, SizedTask<2>,
+        std::conditional_t<sizeof(T) <= SizedTask<3>::PAYLOAD_SIZE, SizedTask<3>, SizedTask<MAX_TASK_LINE_COUNT>>>>;
+
+// Pooled storage for a `T` which isn't a task payload, such as state shared between tasks. It's stored in the
+// payload of a task from the task pools which is never run.
+template<typename T>
+class TaskBox {
+public:
+    template<typename... Args>
+    static Task* create(Args&& ... args) {
+        auto* item = Worker::getTaskPool<TaskClassFor<T>>()->obtain();
+        if (item == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        Task* box = item->data();
+        box->template constructData<T>(std::forward<Args>(args)...);
+        return box;
+    }
+
+    static T& get(Task* box) {
+        return box->template getData<T>();
+    }
+
+    static void destroy(Task* box) {
+        box->template destroyData<T>();
+        PoolSlabHeader::fromAddress(box)->releaseItem(box);
+    }
+};
 
 class TaskChainBuilder {
 private:
@@ -114,16 +244,7 @@ public:
 
     template<typename T>
     [[nodiscard]]
-    TaskChainBuilder* add(T taskFn) {
-        if (!first) {
-            first = TaskGraph::allocate(taskFn, &wrapper);
-            next = first;
-        } else {
-            next->then(taskFn, &wrapper);
-        }
-
-        return this;
-    }
+    TaskChainBuilder* add(T&& taskFn);
 
     PoolItemHandle<Task> submit();
 
@@ -132,39 +253,95 @@ public:
     }
 };
 
+struct TaskGraphOptions {
+    uint32_t numThreads = std::thread::hardware_concurrency();
+    VictimPolicy victimPolicy = VictimPolicy::Random;
+    Worker::IdlePolicy idlePolicy = Worker::IdlePolicy::Park;
+    // Maximum number of idle workers looking for tasks to steal at the same time, 0 for half of the workers.
+    uint32_t maxSearchingWorkers = 0;
+};
+
 class TaskGraph {
 public:
+
     std::vector<Worker> workers;
 
+private:
+    std::array<InjectionQueue, TASK_PRIORITY_COUNT> injectionQueues;
+    TaskPools sharedTaskPools;
+    TaskArena sharedArena;
+    std::mutex sharedArenaMutex;
+    // Idle workers sleep here until tasks are submitted.
+    EventCount idleEvent;
+    // Threads blocked in `wait()` sleep here until a task they pinned finishes, see `Task::finish()`.
+    EventCount waitEvent;
+    alignas(std::hardware_destructive_interference_size) std::atomic<uint32_t> searchingCount;
+    uint32_t maxSearchingCount;
+
 public:
     explicit TaskGraph(uint32_t numThreads);
+    explicit TaskGraph(const TaskGraphOptions& options);
 
     void stop();
+    void submit(PoolItemHandle<Task>& task);
+    void wait(PoolItemHandle<Task>& task);
+    void notifyWork();
+    void notifyCompletion();
+    bool tryStartSearching();
+    void stopSearching(bool foundWork);
+    EventCount& getIdleEvent();
+    EventCount& getWaitEvent();
+    Task* fetchInjectedTask(TaskPriority priority);
+    TaskPools* getSharedTaskPools();
+    void* allocateSharedPayload(size_t size, size_t alignment);
 
     Worker* getWorker(std::thread::id id);
 
     static Worker* getThreadWorker();
     static TaskGraph* get();
     static void init(uint32_t numThreads);
+    static void init(const TaskGraphOptions& options);
     static void shutdown();
 
-    template<typename T>
-    static PoolItemHandle<Task> allocate(T inTaskFn, PoolItemHandle<Task>* parentTaskHandle) {
-        auto* pool = Worker::getTaskPool();
+    // N.B. The callable is moved or copied into the task exactly once.
+    template<typename T, typename Fn = std::decay_t<T>>
+    static PoolItemHandle<Task> allocate(T&& inTaskFn, PoolItemHandle<Task>* parentTaskHandle,
+        TaskPriority priority = TaskPriority::Normal) {
+        auto* pool = Worker::getTaskPool<TaskClassFor<Fn>>();
         auto* parentTask = parentTaskHandle != nullptr ? parentTaskHandle->data() : nullptr;
-        auto* item = pool->obtain([](Task& task) {
-            const auto& taskFn = task.template getData<T>();
-            taskFn(task);
-        }, parentTask);
+        auto* item = pool->obtain(&TASK_OPS<Fn>, parentTask, nullptr, priority);
 
-        // @TODO Throw if `item == nullptr` (pool is empty).
+        if (item == nullptr) {
+            throw std::bad_alloc();
+        }
 
-        auto* task = item->data();
-        task->template constructData<T>(inTaskFn);
-        task->setTeardownFunc([](Task& task) {
-            task.template destroyData<T>();
-        });
+        Task* task = item->data();
+        task->template constructData<Fn>(std::forward<T>(inTaskFn));
 
-        return PoolItemHandle<Task>(item);
+        return PoolItemHandle<Task>(task);
     }
-};
\ No newline at end of file
+};
+
+template<typename T>
+Task* Task::then(T&& inTaskFn, PoolItemHandle<Task>* parentTask) {
+    // N.B. Chains are built before they're submitted, so they don't need to synchronize.
+    if (auto* successor = next.load(std::memory_order_relaxed)) {
+        successor->then(std::forward<T>(inTaskFn), parentTask);
+    } else {
+        next.store(*TaskGraph::allocate(std::forward<T>(inTaskFn), parentTask), std::memory_order_relaxed);
+    }
+
+    return this;
+}
+
+template<typename T>
+TaskChainBuilder* TaskChainBuilder::add(T&& taskFn) {
+    if (!first) {
+        first = TaskGraph::allocate(std::forward<T>(taskFn), &wrapper);
+        next = first;
+    } else {
+        next->then(std::forward<T>(taskFn), &wrapper);
+    }
+
+    return this;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+#include <tuple>
+#include "PoolAllocator.h"
+
+class Task;
+template<size_t LineCount>
+class SizedTask;
+
+// Cache lines taken by tasks of the largest class.
+static constexpr size_t MAX_TASK_LINE_COUNT = 5u;
+
+// One pool per task class, `TaskGraph::allocate()` picks the smallest class the task's payload fits in.
+class TaskPools {
+private:
+    std::tuple<PoolAllocator<Task>, PoolAllocator<SizedTask<2>>, PoolAllocator<SizedTask<3>>,
+        PoolAllocator<SizedTask<MAX_TASK_LINE_COUNT>>> pools;
+
+public:
+    // Plain task pools grow by `slabSize` tasks at a time, pools of larger classes by slabs of about the same
+    // size in bytes.
+    explicit TaskPools(size_t slabSize);
+
+    void setOwner(std::thread::id thread);
+
+    template<typename C>
+    PoolAllocator<C>* get() {
+        return &std::get<PoolAllocator<C>>(pools);
+    }
+};
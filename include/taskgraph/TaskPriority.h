@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Tasks of higher priority are executed and stolen first. Subtasks inherit priority from their parent task.
+enum class TaskPriority : uint8_t {
+    High = 0,
+    Normal = 1,
+    Low = 2
+};
+
+static constexpr size_t TASK_PRIORITY_COUNT = 3u;
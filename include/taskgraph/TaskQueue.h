@@ -1,28 +1,64 @@
 #pragma once
 
-#include <array>
 #include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
 
 class Task;
 
 class TaskQueue {
 private:
-    static constexpr uint32_t MAX_TASK_COUNT = 4096u;
-    static constexpr uint32_t TASK_LOOKUP_MASK = MAX_TASK_COUNT - 1u;
+    static constexpr int64_t INITIAL_CAPACITY = 4096;
 
-    static_assert((MAX_TASK_COUNT != 0) && ((MAX_TASK_COUNT & (MAX_TASK_COUNT - 1)) == 0),
-        "max task count should be a power of 2");
+    static constexpr int64_t MAX_STEAL_BATCH_SIZE = 256;
 
-    std::array<Task*, MAX_TASK_COUNT> tasks;
-    std::atomic<int> top;
-    std::atomic<int> bottom;
+    static_assert((INITIAL_CAPACITY != 0) && ((INITIAL_CAPACITY & (INITIAL_CAPACITY - 1)) == 0),
+        "initial capacity should be a power of 2");
+
+    // Circular array of task slots. Slots are atomic since thieves may read a slot while the owner
+    // is copying the buffer into a bigger one.
+    struct Buffer {
+        int64_t capacity;
+        int64_t mask;
+        std::unique_ptr<std::atomic<Task*>[]> tasks;
+
+        explicit Buffer(int64_t inCapacity);
+
+        Task* get(int64_t index) const {
+            return tasks[index & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, Task* task) {
+            tasks[index & mask].store(task, std::memory_order_relaxed);
+        }
+    };
+
+    // `top` is written by thieves and `bottom` by the owner only, keep them on separate cache lines.
+    alignas(std::hardware_destructive_interference_size) std::atomic<int64_t> top;
+    alignas(std::hardware_destructive_interference_size) std::atomic<int64_t> bottom;
+    std::atomic<Buffer*> buffer;
+
+    // Owner-only list of every buffer allocated by this queue. Buffers that have been replaced by a bigger
+    // one are retired here instead of being deleted, since a thief may still be reading from them. The
+    // capacity doubles with each growth, so retired buffers never take more memory than the current one.
+    std::vector<std::unique_ptr<Buffer>> buffers;
 
 public:
-    TaskQueue()
-        :top { 0 }, bottom { 0 }, tasks { nullptr } { }
+    TaskQueue();
 
     void push(Task* task);
     Task* pop();
     Task* steal();
-    int size();
-};
\ No newline at end of file
+
+    // Steals up to half of the queue: returns one task and moves the rest to `destination`, which must be
+    // owned by the calling thread.
+    Task* stealBatch(TaskQueue& destination);
+
+    size_t size() const;
+    size_t capacity() const;
+
+private:
+    Buffer* grow(Buffer* oldBuffer, int64_t t, int64_t b);
+};
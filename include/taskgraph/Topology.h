@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU cache and socket layout of the machine, used to steal from the closest workers first.
+class Topology {
+public:
+    static constexpr uint32_t SHARED_L2_DISTANCE = 0u;
+    static constexpr uint32_t SHARED_L3_DISTANCE = 1u;
+    static constexpr uint32_t SAME_PACKAGE_DISTANCE = 2u;
+    static constexpr uint32_t REMOTE_DISTANCE = 3u;
+
+    struct Cpu {
+        uint32_t id;
+        // Cache and package groups are identified by the lowest numbered CPU in the group, -1 if unknown.
+        int32_t l2Group;
+        int32_t l3Group;
+        int32_t package;
+    };
+
+private:
+    std::vector<Cpu> cpus;
+
+public:
+    explicit Topology(std::vector<Cpu> inCpus);
+
+    // Reads the layout of CPUs this process is allowed to run on from `/sys/devices/system/cpu`. Falls back to
+    // a flat layout of `std::thread::hardware_concurrency()` CPUs if it's not available.
+    static Topology read();
+
+    [[nodiscard]] size_t getCpuCount() const;
+
+    // Workers are assigned to CPUs in order, wrapping around if there are more workers than CPUs.
+    [[nodiscard]] const Cpu& getWorkerCpu(size_t workerIndex) const;
+    [[nodiscard]] uint32_t distance(size_t workerA, size_t workerB) const;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Topology;
+
+enum class VictimPolicy {
+    // Scan workers in order starting from the last successful victim.
+    Linear = 0,
+    // Scan workers in order starting from a random one for every scan.
+    Random = 1,
+    // Scan workers sharing L2 first, then L3, then the same socket and remote ones last, in random order
+    // within each group. Workers are pinned to CPUs in this mode.
+    Hierarchical = 2
+};
+
+// Per-worker order in which other workers are probed when looking for tasks to steal.
+class VictimSelector {
+private:
+    VictimPolicy policy;
+    uint32_t rngState;
+    // Other workers, grouped by distance from the owning worker.
+    std::vector<uint32_t> victims;
+    // End of each distance group in `victims`.
+    std::vector<uint32_t> groupEnds;
+    // Offset each group is rotated by for the current scan.
+    std::vector<uint32_t> groupOffsets;
+
+public:
+    VictimSelector();
+    VictimSelector(VictimPolicy inPolicy, size_t workerIndex, size_t workerCount, const Topology* topology);
+
+    [[nodiscard]] size_t victimCount() const {
+        return victims.size();
+    }
+
+    void beginScan();
+
+    // Returns the worker to probe on given attempt of the current scan. A scan probes all other workers once.
+    [[nodiscard]] size_t victim(size_t attempt) const {
+        uint32_t groupBegin = 0;
+        for (auto i = 0u; i < groupEnds.size(); i++) {
+            auto groupEnd = groupEnds[i];
+            if (attempt < groupEnd) {
+                auto groupSize = groupEnd - groupBegin;
+                auto pos = (uint32_t)attempt - groupBegin + groupOffsets[i];
+                if (pos >= groupSize) {
+                    pos -= groupSize;
+                }
+
+                return victims[groupBegin + pos];
+            }
+
+            groupBegin = groupEnd;
+        }
+
+        return victims[attempt];
+    }
+
+    void onSteal(size_t attempt);
+
+private:
+    uint32_t nextRandom(uint32_t bound);
+};
@@ -1,12 +1,37 @@
 #pragma once
 
 #include <thread>
+#include <array>
+#include "EventCount.h"
 #include "PoolAllocator.h"
+#include "TaskArena.h"
+#include "TaskPools.h"
+#include "TaskPriority.h"
 #include "TaskQueue.h"
+#include "VictimSelector.h"
+
+class TaskGraph;
 
 class Worker {
 public:
-    static constexpr size_t TASK_POOL_SIZE = 4096u;
+    // Task pools grow by this many tasks at a time.
+    static constexpr size_t TASK_POOL_SLAB_SIZE = 4096u;
+
+    // Every this many fetches the priority order is reversed, which bounds starvation of lower priorities.
+    static constexpr uint32_t PRIORITY_STARVATION_LIMIT = 16u;
+
+    // Idle workers spin with exponential backoff for an adaptive number of rounds between these bounds.
+    static constexpr uint32_t MIN_SPIN_ROUNDS = 8u;
+    static constexpr uint32_t MAX_SPIN_ROUNDS = 256u;
+    static constexpr uint32_t MAX_BACKOFF_SHIFT = 6u;
+
+    // Past this many nested waits, a waiting worker only runs tasks the waited task needs to finish, see
+    // `Task::isNeededBy()`. Other tasks may wait as well, so running them could stack waits without bound. They're
+    // left to other workers, and the waiting worker sleeps until the waited task has finished if there's nothing
+    // it can run.
+    static constexpr uint32_t MAX_WAIT_DEPTH = 32u;
+    // Past `MAX_WAIT_DEPTH`, a waiting worker looks at up to this many of its local tasks per round.
+    static constexpr size_t MAX_WAIT_SCAN = 16u;
 
     enum class Mode {
         Background = 0,
@@ -19,6 +44,13 @@ public:
         Stopping = 2
     };
 
+    enum class IdlePolicy {
+        // Keep spinning and yielding while there's no work.
+        Spin = 0,
+        // Spin briefly, then sleep until new tasks are submitted.
+        Park = 1
+    };
+
     std::thread::id id;
     std::thread thread;
     std::atomic<State> state;
@@ -28,29 +60,61 @@ public:
 #endif
 
 private:
-    TaskQueue queue;
+    std::array<TaskQueue, TASK_PRIORITY_COUNT> queues;
     std::atomic<Mode> mode;
-    PoolAllocator<Task> pool;
-    size_t stealIndex;
-    size_t workerCount;
+    TaskPools pools;
+    TaskArena arena;
+    TaskGraph* taskGraph;
+    size_t index;
+    uint32_t fetchCount;
+    VictimSelector victimSelector;
+    // CPU the worker thread is pinned to, -1 if it isn't.
+    int32_t cpu;
+    IdlePolicy idlePolicy;
+    uint32_t spinRounds;
+    // Number of nested `wait()` calls on the worker's thread.
+    uint32_t waitDepth;
+    // Local tasks of every priority left to look at before a wait past `MAX_WAIT_DEPTH` goes idle, see
+    // `fetchWaitTask()`.
+    std::array<size_t, TASK_PRIORITY_COUNT> waitScanCounts;
 
 public:
     Worker();
     ~Worker();
 
-    void start(size_t inIndex, size_t inWorkerCount, Mode inMode);
+    void start(TaskGraph* inTaskGraph, size_t inIndex, Mode inMode, VictimSelector inVictimSelector, int32_t inCpu,
+        IdlePolicy inIdlePolicy);
     void stop();
     void join();
     void submit(PoolItemHandle<Task>& task);
     void wait(PoolItemHandle<Task>& task);
     void clear();
 
+    // Whether the worker has submitted tasks which haven't been started or stolen yet.
+    bool hasLocalTasks() const;
+
     static Worker* getThreadWorker();
-    static PoolAllocator<Task>* getTaskPool();
+    static TaskPools* getTaskPools();
+    // Allocates memory for a task payload that doesn't fit inline, freed with `TaskArena::free()`.
+    static void* allocatePayload(size_t size, size_t alignment);
+
+    template<typename C = Task>
+    static PoolAllocator<C>* getTaskPool() {
+        return getTaskPools()->get<C>();
+    }
 
 private:
     void run();
-    Task* fetchTask();
+    void pinToCpu();
+    void execute(Task* task, uint32_t& idleRounds);
+    bool backoff(uint32_t& idleRounds);
+    template<typename F, typename G>
+    void park(EventCount& event, F&& shouldWake, G&& fetch);
+    Task* fetchTask(bool searching = true);
+    Task* fetchWaitTask(Task* waitedTask);
+    void resetWaitScan();
+    bool isWaitScanDone() const;
+    Task* fetchTask(TaskPriority priority, bool steal);
 };
 
 namespace {
@@ -2,9 +2,22 @@
 
 #include <iostream>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
 namespace utils {
     template<typename ...Args>
     void print(Args&& ...args) {
         (std::cout << ... << args) << std::endl;
     }
-}
\ No newline at end of file
+
+    // Hints the CPU that the caller is spin-waiting.
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
+}
@@ -1,49 +1,225 @@
 #pragma once
 
+#include <functional>
+#include <initializer_list>
 #include <thread>
+#include "taskgraph/CoTask.h"
+#include "taskgraph/ParallelReduce.h"
+#include "taskgraph/ParallelScan.h"
+#include "taskgraph/ParallelSort.h"
+#include "taskgraph/Pipeline.h"
+#include "taskgraph/RangeSplitter.h"
+#include "taskgraph/RecordedGraph.h"
+#include "taskgraph/TaskFuture.h"
 #include "taskgraph/TaskGraph.h"
 
 namespace tasks {
     using TaskHandle = PoolItemHandle<Task>;
+    using Priority = TaskPriority;
+    using Options = TaskGraphOptions;
+    using Graph = RecordedGraph;
+    using StageMode = PipelineStageMode;
+    using FlowControl = PipelineFlowControl;
 
     TaskGraph* getGraph();
     void init(uint32_t numThreads = std::thread::hardware_concurrency());
+    void init(const Options& options);
     void shutdown();
+    // Waits for a task and its subtasks to finish. Workers run other tasks meanwhile, so tasks can wait as well.
     void wait(TaskHandle& task);
 
     template<typename T>
     [[nodiscard]]
-    inline TaskHandle create(T taskFn) {
-        return TaskGraph::template allocate<T>(taskFn, nullptr);
+    inline TaskHandle create(T&& taskFn) {
+        return TaskGraph::allocate(std::forward<T>(taskFn), nullptr);
     }
 
     template<typename T>
     [[nodiscard]]
-    inline TaskHandle create(TaskHandle& parent, T taskFn) {
-        return TaskGraph::template allocate<T>(taskFn, &parent);
+    inline TaskHandle create(Priority priority, T&& taskFn) {
+        return TaskGraph::allocate(std::forward<T>(taskFn), nullptr, priority);
     }
 
     template<typename T>
     [[nodiscard]]
-    inline TaskHandle create(Task& parent, T taskFn) {
+    inline TaskHandle create(TaskHandle& parent, T&& taskFn) {
+        return TaskGraph::allocate(std::forward<T>(taskFn), &parent);
+    }
+
+    template<typename T>
+    [[nodiscard]]
+    inline TaskHandle create(Task& parent, T&& taskFn) {
         auto handle = TaskHandle(&parent);
-        return TaskGraph::template allocate<T>(taskFn, &handle);
+        return TaskGraph::allocate(std::forward<T>(taskFn), &handle);
+    }
+
+    template<typename T>
+    inline TaskHandle add(T&& taskFn) {
+        return create(std::forward<T>(taskFn))->submit();
     }
 
     template<typename T>
-    inline TaskHandle add(T taskFn) {
-        return create<T>(taskFn)->submit();
+    inline TaskHandle add(Priority priority, T&& taskFn) {
+        return create(priority, std::forward<T>(taskFn))->submit();
     }
 
     template<typename T>
-    inline TaskHandle add(TaskHandle& parent, T taskFn) {
-        return create<T>(parent, taskFn)->submit();
+    inline TaskHandle add(TaskHandle& parent, T&& taskFn) {
+        return create(parent, std::forward<T>(taskFn))->submit();
     }
 
     template<typename T>
-    inline TaskHandle add(Task& parent, T taskFn) {
+    inline TaskHandle add(Task& parent, T&& taskFn) {
         auto handle = TaskHandle(&parent);
-        return create<T>(handle, taskFn)->submit();
+        return create(handle, std::forward<T>(taskFn))->submit();
+    }
+
+    // Submits `taskFn` once all of `predecessors` have finished. Predecessors may be running or have finished
+    // already, and those which haven't been submitted yet have to be submitted separately. If the edges can't be
+    // added, see `Task::MAX_PREDECESSOR_COUNT`, the exception is rethrown and `taskFn` is never run.
+    template<typename T>
+    inline TaskHandle after(std::initializer_list<TaskHandle> predecessors, T&& taskFn) {
+        auto task = create(std::forward<T>(taskFn));
+        try {
+            Task::precede(predecessors, *task);
+        } catch (...) {
+            // No edge was added, so finishing the task releases it without running it.
+            task->finish();
+            throw;
+        }
+
+        return task->submit();
+    }
+
+    // Calls `fn(i)` for every index of `[begin, end)` from tasks spread over the workers, see `RangeSplitter`.
+    // Ranges of at most `grainSize` indices aren't split any further, 0 picks a grain size automatically.
+    template<typename B, typename E, typename T, typename Index = std::common_type_t<B, E>>
+    inline TaskHandle parallel_for(B begin, E end, T&& fn, size_t grainSize = 0) {
+        return add([begin = (Index)begin, end = (Index)end, grainSize, fn = std::forward<T>(fn)](auto& task) {
+            auto grain = RangeSplitter::getGrainSize(end > begin ? (size_t)(end - begin) : 0u, grainSize);
+            RangeSplitter::forEachChunk(task, begin, end, grain, [&fn](Index chunkBegin, Index chunkEnd) {
+                for (auto i = chunkBegin; i < chunkEnd; i++) {
+                    fn(i);
+                }
+            });
+        });
+    }
+
+    template<typename B, typename E, typename T, typename Index = std::common_type_t<B, E>>
+    inline TaskHandle parallel_for(Task& parent, B begin, E end, T&& fn, size_t grainSize = 0) {
+        return add(parent, [begin = (Index)begin, end = (Index)end, grainSize, fn = std::forward<T>(fn)](auto& task) {
+            auto grain = RangeSplitter::getGrainSize(end > begin ? (size_t)(end - begin) : 0u, grainSize);
+            RangeSplitter::forEachChunk(task, begin, end, grain, [&fn](Index chunkBegin, Index chunkEnd) {
+                for (auto i = chunkBegin; i < chunkEnd; i++) {
+                    fn(i);
+                }
+            });
+        });
+    }
+
+    // Folds `[first, last)` with the associative `op`, starting every part of the range the workers split it into
+    // from `identity`. Sums of arithmetic values in contiguous arrays use vectorized leaf kernels, which
+    // reassociate floating point sums.
+    template<typename Iterator, typename T, typename Op = std::plus<>>
+    [[nodiscard]]
+    inline TaskFuture<T> parallel_reduce(Iterator first, Iterator last, T identity, Op op = {}, size_t grainSize = 0) {
+        auto grain = RangeSplitter::getGrainSize(first < last ? (size_t)(last - first) : 0u, grainSize);
+        auto* contextBox = TaskBox<ReduceContext<T, Op>>::create(
+            ReduceContext<T, Op> { std::move(identity), std::move(op), grain });
+        auto future = TaskFuture<T>::createWith([&](Task* stateBox) {
+            return ReduceTaskFn<Iterator, T, Op>(first, last, contextBox, stateBox, true);
+        }, nullptr);
+        future.getTask()->submit();
+        return future;
+    }
+
+    // Writes the inclusive scan of `[first, last)` with the associative `op` to `dest`, which may be `first`.
+    template<typename InputIterator, typename OutputIterator, typename Op = std::plus<>>
+    inline TaskHandle parallel_scan(InputIterator first, InputIterator last, OutputIterator dest, Op op = {}) {
+        return add(ScanTaskFn<InputIterator, OutputIterator, Op>(first, last, dest, std::move(op)));
+    }
+
+    // Sorts `[first, last)` like `std::sort` does, with a parallel merge sort. Values have to be default
+    // constructible, as the merge sort needs a buffer of the same size as the range.
+    template<typename Iterator, typename Compare = std::less<>>
+    inline TaskHandle parallel_sort(Iterator first, Iterator last, Compare compare = {}) {
+        return add(MergeSortTaskFn<Iterator, Compare>(first, last, std::move(compare)));
+    }
+
+    // Sorts a contiguous range of integers in ascending order with a parallel radix sort.
+    template<typename Iterator, typename T = typename std::iterator_traits<Iterator>::value_type>
+    inline TaskHandle parallel_radix_sort(Iterator first, Iterator last) {
+        auto count = first < last ? (size_t)(last - first) : 0u;
+        return add(RadixSortTaskFn<T>(count > 0 ? &*first : nullptr, count));
+    }
+
+    template<typename T>
+    inline PipelineStage<std::decay_t<T>> stage(StageMode mode, T&& fn) {
+        return { mode, std::forward<T>(fn) };
+    }
+
+    // Runs `input(flow)` to produce items until it calls `flow.stop()`, passing every item through `stages` made
+    // with `tasks::stage`, the output of a stage is the input of the next. At most `tokenCount` items are in
+    // flight at once, the input waits for one of them to make it through the last stage before producing more.
+    template<typename Input, typename... Stages>
+    inline TaskHandle pipeline(size_t tokenCount, Input&& input, Stages&&... stages) {
+        static_assert(sizeof...(Stages) > 0, "pipelines need at least one stage after the input");
+        return add(PipelineTaskFn<std::decay_t<Input>, std::decay_t<Stages>...>(tokenCount,
+            std::decay_t<Input>(std::forward<Input>(input)), std::decay_t<Stages>(std::forward<Stages>(stages))...));
+    }
+
+    // Runs `taskFn` like `add` does, with its result available through the returned future once the task has
+    // finished.
+    template<typename T, typename R = TaskResult<std::decay_t<T>>>
+    [[nodiscard]]
+    inline TaskFuture<R> async(T&& taskFn) {
+        auto future = TaskFuture<R>::create(std::forward<T>(taskFn), nullptr);
+        future.getTask()->submit();
+        return future;
+    }
+
+    template<typename T, typename R = TaskResult<std::decay_t<T>>>
+    [[nodiscard]]
+    inline TaskFuture<R> async(Priority priority, T&& taskFn) {
+        auto future = TaskFuture<R>::create(std::forward<T>(taskFn), nullptr, priority);
+        future.getTask()->submit();
+        return future;
+    }
+
+    template<typename T, typename R = TaskResult<std::decay_t<T>>>
+    [[nodiscard]]
+    inline TaskFuture<R> async(TaskHandle& parent, T&& taskFn) {
+        auto future = TaskFuture<R>::create(std::forward<T>(taskFn), &parent);
+        future.getTask()->submit();
+        return future;
+    }
+
+    template<typename T, typename R = TaskResult<std::decay_t<T>>>
+    [[nodiscard]]
+    inline TaskFuture<R> async(Task& parent, T&& taskFn) {
+        auto handle = TaskHandle(&parent);
+        return async(handle, std::forward<T>(taskFn));
+    }
+
+#ifdef TASKGRAPH_HAS_COROUTINES
+    template<typename T = void>
+    using co_task = CoTask<T>;
+
+    // Runs a coroutine task, with its result available through the returned future once it has returned.
+    template<typename T>
+    [[nodiscard]]
+    inline TaskFuture<T> async(co_task<T>&& coTask) {
+        auto future = TaskFuture<T>::createWith([&](Task* stateBox) {
+            return CoTaskFn<T>(std::move(coTask), stateBox);
+        }, nullptr);
+        future.getTask()->submit();
+        return future;
+    }
+#endif
+
+    template<typename R>
+    inline void wait(TaskFuture<R>& future) {
+        wait(future.getTask());
     }
 
     [[nodiscard]]
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <climits>
+#include "taskgraph/EventCount.h"
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    void futexWait(std::atomic<uint32_t>* address, uint32_t expected) {
+        syscall(SYS_futex, (uint32_t*)address, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    void futexWake(std::atomic<uint32_t>* address, uint32_t count) {
+        syscall(SYS_futex, (uint32_t*)address, FUTEX_WAKE_PRIVATE, (int)std::min<uint32_t>(count, INT_MAX), nullptr,
+            nullptr, 0);
+    }
+}
+#endif
+
+EventCount::EventCount()
+    :epoch { 0 }, waiters { 0 } {
+}
+
+EventCount::Key EventCount::prepareWait() {
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+
+    // Pairs with the fence in `notify()`: either the notifier sees this waiter, or the waiter sees the condition
+    // the notifier has made true when it re-checks it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch.load(std::memory_order_acquire);
+}
+
+void EventCount::cancelWait() {
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void EventCount::wait(Key key) {
+#if defined(__linux__)
+    while (epoch.load(std::memory_order_acquire) == key) {
+        futexWait(&epoch, key);
+    }
+#else
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [&]() {
+            return epoch.load(std::memory_order_acquire) != key;
+        });
+    }
+#endif
+
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void EventCount::notify(uint32_t count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+#if defined(__linux__)
+    epoch.fetch_add(1, std::memory_order_release);
+    futexWake(&epoch, count);
+#else
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        epoch.fetch_add(1, std::memory_order_release);
+    }
+
+    if (count == 1) {
+        condition.notify_one();
+    } else {
+        condition.notify_all();
+    }
+#endif
+}
+
+void EventCount::notifyAll() {
+    notify(UINT32_MAX);
+}
+
+uint32_t EventCount::waiterCount() const {
+    return waiters.load(std::memory_order_seq_cst);
+}
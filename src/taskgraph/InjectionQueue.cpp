@@ -0,0 +1,69 @@
+#include "taskgraph/InjectionQueue.h"
+
+InjectionQueue::InjectionQueue()
+    :cells { new Cell[CAPACITY] }, enqueuePos { 0 }, dequeuePos { 0 } {
+    for (auto i = 0u; i < CAPACITY; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+        cells[i].task = nullptr;
+    }
+}
+
+bool InjectionQueue::push(Task* task) {
+    Cell* cell;
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+    while (true) {
+        cell = &cells[pos & CELL_LOOKUP_MASK];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        auto diff = (intptr_t)sequence - (intptr_t)pos;
+
+        if (diff == 0) {
+            // The cell is free, try to claim it.
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // The cell still holds a task from the previous lap, the queue is full.
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->task = task;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+Task* InjectionQueue::pop() {
+    Cell* cell;
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+    while (true) {
+        cell = &cells[pos & CELL_LOOKUP_MASK];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        auto diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+
+        if (diff == 0) {
+            // The cell holds a task, try to claim it.
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // The cell hasn't been written yet, the queue is empty.
+            return nullptr;
+        } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    auto* task = cell->task;
+    cell->sequence.store(pos + CAPACITY, std::memory_order_release);
+    return task;
+}
+
+size_t InjectionQueue::size() const {
+    size_t enqueued = enqueuePos.load(std::memory_order_relaxed);
+    size_t dequeued = dequeuePos.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
@@ -0,0 +1,171 @@
+#include <cassert>
+#include "taskgraph/Pipeline.h"
+#include "taskgraph/TaskGraph.h"
+
+Pipeline::SerialStage::SerialStage(bool inInOrder, size_t tokenCount)
+    :inOrder { inInOrder }, busy { false }, nextSequence { 0 }, pending(tokenCount, nullptr), pendingBegin { 0 },
+    pendingCount { 0 } {
+}
+
+Pipeline::Pipeline(const std::vector<PipelineStageMode>& modes, std::vector<Token*> inTokens, void* inStages,
+    StageFn inRunStage)
+    :stages { inStages }, runStage { inRunStage }, stageCount { (uint32_t)modes.size() },
+    tokens { std::move(inTokens) }, inputBusy { false }, stopped { false }, nextSequence { 0 }, runTask { nullptr } {
+    assert(stageCount >= 2 && !tokens.empty());
+
+    // The input is stage 0, it's always serial but never needs to wait for tokens.
+    serialStages.resize(stageCount);
+    for (auto stage = 1u; stage < stageCount; stage++) {
+        if (modes[stage] != PipelineStageMode::Parallel) {
+            serialStages[stage] = std::make_unique<SerialStage>(modes[stage] == PipelineStageMode::SerialInOrder,
+                tokens.size());
+        }
+    }
+}
+
+void Pipeline::spawn(Token* token) {
+    auto parent = PoolItemHandle<Task>(runTask);
+    TaskGraph::allocate([this, token](Task&) {
+        process(token);
+    }, &parent)->submit();
+}
+
+void Pipeline::spawnInput() {
+    auto parent = PoolItemHandle<Task>(runTask);
+    TaskGraph::allocate([this](Task&) {
+        pull();
+    }, &parent)->submit();
+}
+
+void Pipeline::pull() {
+    Token* token;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        if (stopped || freeTokens.empty()) {
+            inputBusy = false;
+            return;
+        }
+
+        token = freeTokens.back();
+        freeTokens.pop_back();
+    }
+
+    token->sequence = nextSequence++;
+    token->stage = 0;
+
+    PipelineFlowControl flow;
+    runStage(stages, 0, *token, flow);
+
+    bool handOver;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        if (flow.isStopped()) {
+            stopped = true;
+            inputBusy = false;
+            freeTokens.push_back(token);
+            return;
+        }
+
+        handOver = !freeTokens.empty();
+        inputBusy = handOver;
+    }
+
+    // The input is handed over to another task while this one carries on with the token.
+    if (handOver) {
+        spawnInput();
+    }
+
+    token->stage = 1;
+    if (enter(token)) {
+        process(token);
+    }
+}
+
+void Pipeline::process(Token* token) {
+    while (true) {
+        PipelineFlowControl flow;
+        runStage(stages, token->stage, *token, flow);
+        if (serialStages[token->stage]) {
+            leave(token->stage);
+        }
+
+        if (++token->stage == stageCount) {
+            release(token);
+            return;
+        }
+
+        if (!enter(token)) {
+            return;
+        }
+    }
+}
+
+bool Pipeline::enter(Token* token) {
+    auto* stage = serialStages[token->stage].get();
+    if (stage == nullptr) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(stage->mutex);
+    if (stage->inOrder) {
+        if (stage->busy || token->sequence != stage->nextSequence) {
+            stage->pending[token->sequence % stage->pending.size()] = token;
+            return false;
+        }
+    } else if (stage->busy) {
+        stage->pending[(stage->pendingBegin + stage->pendingCount++) % stage->pending.size()] = token;
+        return false;
+    }
+
+    stage->busy = true;
+    return true;
+}
+
+void Pipeline::leave(uint32_t stageIndex) {
+    auto* stage = serialStages[stageIndex].get();
+    Token* next = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(stage->mutex);
+        if (stage->inOrder) {
+            // N.B. Tokens waiting for an in-order stage are within a token count of the next sequence number, as
+            // all tokens in between haven't passed the stage yet.
+            auto& slot = stage->pending[++stage->nextSequence % stage->pending.size()];
+            if (slot != nullptr && slot->sequence == stage->nextSequence) {
+                next = std::exchange(slot, nullptr);
+            }
+        } else if (stage->pendingCount > 0) {
+            next = stage->pending[stage->pendingBegin];
+            stage->pendingBegin = (stage->pendingBegin + 1) % stage->pending.size();
+            stage->pendingCount--;
+        }
+
+        stage->busy = next != nullptr;
+    }
+
+    if (next != nullptr) {
+        spawn(next);
+    }
+}
+
+void Pipeline::release(Token* token) {
+    bool resume;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        freeTokens.push_back(token);
+        resume = !inputBusy && !stopped;
+        inputBusy = inputBusy || resume;
+    }
+
+    if (resume) {
+        spawnInput();
+    }
+}
+
+void Pipeline::run(Task& task) {
+    runTask = &task;
+    freeTokens = tokens;
+    inputBusy = true;
+    stopped = false;
+    nextSequence = 0;
+    pull();
+}
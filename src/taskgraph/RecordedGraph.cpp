@@ -0,0 +1,174 @@
+#include <cassert>
+#include <stdexcept>
+#include "taskgraph/RecordedGraph.h"
+#include "taskgraph/TaskGraph.h"
+
+RecordedGraph::RecordedGraph()
+    :storageUsed { STORAGE_CHUNK_SIZE }, compiled { false }, runTask { nullptr } {
+}
+
+RecordedGraph::~RecordedGraph() {
+    for (auto& fn : functions) {
+        fn.destroy(fn.data);
+    }
+}
+
+void* RecordedGraph::allocateStorage(size_t size, size_t alignment) {
+    if (size > STORAGE_CHUNK_SIZE) {
+        // Large callables get a chunk of their own, the current chunk is kept for smaller ones.
+        auto chunk = std::make_unique<std::max_align_t[]>(
+            (size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t));
+        auto* data = chunk.get();
+        storage.insert(storage.empty() ? storage.end() : storage.end() - 1, std::move(chunk));
+        return data;
+    }
+
+    auto offset = (storageUsed + alignment - 1) / alignment * alignment;
+    if (offset + size > STORAGE_CHUNK_SIZE) {
+        storage.emplace_back(std::make_unique<std::max_align_t[]>(STORAGE_CHUNK_SIZE / sizeof(std::max_align_t)));
+        offset = 0;
+    }
+
+    storageUsed = offset + size;
+    return (uint8_t*)storage.back().get() + offset;
+}
+
+RecordedGraph::Node RecordedGraph::addNode(NodeFn fn) {
+    functions.push_back(fn);
+    compiled = false;
+    return (Node)(functions.size() - 1);
+}
+
+void RecordedGraph::precede(Node predecessor, Node successor) {
+    assert(predecessor < functions.size() && successor < functions.size());
+    edges.emplace_back(predecessor, successor);
+    compiled = false;
+}
+
+size_t RecordedGraph::size() const {
+    return functions.size();
+}
+
+void RecordedGraph::compile() {
+    auto nodeCount = functions.size();
+
+    // Successors of every recorded node, in compressed rows.
+    std::vector<uint32_t> edgeOffsets(nodeCount + 1, 0);
+    std::vector<uint32_t> inDegrees(nodeCount, 0);
+    for (auto& [from, to] : edges) {
+        edgeOffsets[from + 1]++;
+        inDegrees[to]++;
+    }
+
+    for (auto i = 0u; i < nodeCount; i++) {
+        edgeOffsets[i + 1] += edgeOffsets[i];
+    }
+
+    std::vector<uint32_t> edgeTargets(edges.size());
+    std::vector<uint32_t> edgeFill(edgeOffsets.begin(), edgeOffsets.end() - 1);
+    for (auto& [from, to] : edges) {
+        edgeTargets[edgeFill[from]++] = to;
+    }
+
+    // Kahn's algorithm, which numbers nodes in the order they become ready.
+    std::vector<uint32_t> order;
+    order.reserve(nodeCount);
+    std::vector<uint32_t> remaining = inDegrees;
+    for (auto i = 0u; i < nodeCount; i++) {
+        if (remaining[i] == 0) {
+            order.push_back(i);
+        }
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        auto node = order[i];
+        for (auto edge = edgeOffsets[node]; edge < edgeOffsets[node + 1]; edge++) {
+            if (--remaining[edgeTargets[edge]] == 0) {
+                order.push_back(edgeTargets[edge]);
+            }
+        }
+    }
+
+    // Nodes on a cycle never become ready, running the rest would leave them out and the run would never finish.
+    if (order.size() != nodeCount) {
+        throw std::logic_error("recorded graph has a cycle");
+    }
+
+    std::vector<uint32_t> indices(nodeCount);
+    for (auto i = 0u; i < order.size(); i++) {
+        indices[order[i]] = i;
+    }
+
+    nodes.clear();
+    nodes.reserve(order.size());
+    successors.clear();
+    successors.reserve(edges.size());
+    roots.clear();
+
+    for (auto node : order) {
+        auto begin = (uint32_t)successors.size();
+        for (auto edge = edgeOffsets[node]; edge < edgeOffsets[node + 1]; edge++) {
+            successors.push_back(indices[edgeTargets[edge]]);
+        }
+
+        if (inDegrees[node] == 0) {
+            roots.push_back(indices[node]);
+        }
+
+        nodes.push_back({ functions[node], begin, (uint32_t)successors.size(), inDegrees[node] });
+    }
+
+    pendingCounts = std::make_unique<std::atomic<uint32_t>[]>(nodes.size());
+    compiled = true;
+}
+
+RecordedGraph::NodeTaskFn::NodeTaskFn(RecordedGraph* inGraph, uint32_t inIndex)
+    :graph { inGraph }, index { inIndex } {
+}
+
+RecordedGraph::NodeTaskFn::NodeTaskFn(NodeTaskFn&& other) noexcept
+    :graph { std::exchange(other.graph, nullptr) }, index { other.index } {
+}
+
+RecordedGraph::NodeTaskFn::~NodeTaskFn() {
+    if (graph != nullptr) {
+        graph->releaseSuccessors(index);
+    }
+}
+
+void RecordedGraph::NodeTaskFn::operator()(Task& task) {
+    auto& fn = graph->nodes[index].fn;
+    fn.invoke(fn.data, task);
+}
+
+void RecordedGraph::spawn(Task& parent, uint32_t index) {
+    auto parentHandle = PoolItemHandle<Task>(&parent);
+    TaskGraph::allocate(NodeTaskFn(this, index), &parentHandle)->submit();
+}
+
+void RecordedGraph::releaseSuccessors(uint32_t index) {
+    auto& node = nodes[index];
+    for (auto i = node.successorBegin; i < node.successorEnd; i++) {
+        auto successor = successors[i];
+        if (pendingCounts[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            spawn(*runTask, successor);
+        }
+    }
+}
+
+PoolItemHandle<Task> RecordedGraph::run() {
+    if (!compiled) {
+        compile();
+    }
+
+    for (auto i = 0u; i < nodes.size(); i++) {
+        pendingCounts[i].store(nodes[i].inDegree, std::memory_order_relaxed);
+    }
+
+    return TaskGraph::allocate([this](Task& task) {
+        runTask = &task;
+        for (auto root : roots) {
+            spawn(task, root);
+        }
+    }, nullptr)->submit();
+}
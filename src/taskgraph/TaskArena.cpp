@@ -0,0 +1,119 @@
+#include <cassert>
+#include "taskgraph/TaskArena.h"
+
+namespace {
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+TaskArena::TaskArena()
+    :current { nullptr }, freeChunks { nullptr }, remoteFreeChunks { nullptr }, chunks {} {
+}
+
+TaskArena::~TaskArena() {
+    assert(current == nullptr || current->liveCount == 1);
+
+    for (auto* chunk : chunks) {
+        chunk->~Chunk();
+        ::operator delete(chunk, std::align_val_t(CHUNK_SIZE));
+    }
+}
+
+TaskArena::Chunk* TaskArena::createChunk(size_t capacity, bool dedicated, TaskArena* arena) {
+    auto* memory = ::operator new(sizeof(Chunk) + capacity, std::align_val_t(CHUNK_SIZE));
+    auto* chunk = new(memory)Chunk {};
+    chunk->dedicated = dedicated;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    chunk->arena = arena;
+    chunk->next = nullptr;
+
+    return chunk;
+}
+
+TaskArena::Chunk* TaskArena::obtainChunk() {
+    if (freeChunks == nullptr) {
+        freeChunks = remoteFreeChunks.exchange(nullptr, std::memory_order_acquire);
+    }
+
+    Chunk* chunk = freeChunks;
+    if (chunk != nullptr) {
+        freeChunks = chunk->next;
+    } else {
+        chunk = createChunk(CHUNK_SIZE - sizeof(Chunk), false, this);
+        chunks.push_back(chunk);
+    }
+
+    chunk->used = 0;
+    chunk->liveCount.store(1, std::memory_order_relaxed);
+
+    return chunk;
+}
+
+void TaskArena::retire(Chunk* chunk) {
+    if (chunk->dedicated) {
+        chunk->~Chunk();
+        ::operator delete(chunk, std::align_val_t(CHUNK_SIZE));
+        return;
+    }
+
+    // Chunks are only ever taken from the stack all at once, so pushes don't suffer from ABA.
+    auto* arena = chunk->arena;
+    Chunk* oldHead = arena->remoteFreeChunks.load(std::memory_order_relaxed);
+    do {
+        chunk->next = oldHead;
+    } while (!arena->remoteFreeChunks.compare_exchange_weak(oldHead, chunk, std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+void* TaskArena::allocate(size_t size, size_t alignment) {
+    assert(alignment <= alignof(Chunk));
+
+    if (sizeof(Chunk) + size > CHUNK_SIZE) {
+        auto* chunk = createChunk(size, true, this);
+        chunk->liveCount.store(1, std::memory_order_relaxed);
+        return chunk->data();
+    }
+
+    if (current != nullptr) {
+        // Start over once everything allocated from the chunk has been freed.
+        if (current->liveCount.load(std::memory_order_acquire) == 1) {
+            current->used = 0;
+        }
+
+        auto offset = alignUp(current->used, alignment);
+        if (offset + size <= current->capacity) {
+            current->used = offset + size;
+            current->liveCount.fetch_add(1, std::memory_order_relaxed);
+            return current->data() + offset;
+        }
+
+        // Drop the owner's reference, the chunk can be reused right away if nothing allocated from it is alive.
+        if (current->liveCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            current->used = 0;
+            current->liveCount.store(1, std::memory_order_relaxed);
+        } else {
+            current = nullptr;
+        }
+    }
+
+    if (current == nullptr) {
+        current = obtainChunk();
+    }
+
+    current->used = size;
+    current->liveCount.fetch_add(1, std::memory_order_relaxed);
+    return current->data();
+}
+
+void TaskArena::free(void* data) {
+    auto* chunk = (Chunk*)((uintptr_t)data & ~(uintptr_t)(CHUNK_SIZE - 1));
+    if (chunk->liveCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        retire(chunk);
+    }
+}
+
+size_t TaskArena::chunkCount() const {
+    return chunks.size();
+}
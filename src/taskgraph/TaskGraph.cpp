@@ -1,17 +1,23 @@
+#include <algorithm>
 #include <cassert>
+#include <stdexcept>
 #include "taskgraph/PoolAllocator.h"
 #include "taskgraph/TaskGraph.h"
+#include "taskgraph/Topology.h"
 
-Task::Task(Task::TaskCallback inTaskFn, Task* parentTask, Task* nextTask)
-    :taskFn { inTaskFn }, parent { parentTask }, next { nextTask }, childTaskCount { 1 }, payload {} {
+const TaskOps Task::EDGE_OPS { nullptr, nullptr };
+
+Task::Task(const TaskOps* inOps, Task* parentTask, Task* nextTask, TaskPriority inPriority)
+    :ops { inOps }, parent { parentTask }, next { nextTask }, childTaskCount { 1 },
+     priority { parentTask != nullptr ? parentTask->priority : inPriority }, dependencyCount { 1 }, payload {} {
     if (parent != nullptr) {
         parent->childTaskCount++;
     }
 }
 
 void Task::run() {
-    if (taskFn != nullptr) {
-        taskFn(*this);
+    if (ops != nullptr) {
+        ops->run(*this);
     }
 
     finish();
@@ -20,33 +26,197 @@ void Task::run() {
 void Task::finish() {
     size_t remaining = --childTaskCount;
     if (!remaining) {
+        // N.B. The payload is destroyed before the parent is notified, so payloads may still spawn subtasks of
+        // the parent, and the parent doesn't finish while payloads of its subtasks are alive.
+        if (ops != nullptr && ops->destroy != nullptr) {
+            ops->destroy(*this);
+        }
+
         if (parent != nullptr) {
             parent->finish();
         }
 
-        if (teardownFn != nullptr) {
-            teardownFn(*this);
+        // Close the successor list, so that successors added from now on don't wait for this task.
+        auto* successor = next.exchange(finishedSuccessors(), std::memory_order_acq_rel);
+        while (successor != nullptr) {
+            if (successor->ops != &EDGE_OPS) {
+                successor->submit();
+                break;
+            }
+
+            auto* edge = successor;
+            successor = edge->next.load(std::memory_order_relaxed);
+            edge->getData<Task*>()->submit();
+            PoolSlabHeader::fromAddress(edge)->releaseItem(edge);
+        }
+
+        // N.B. The task may be of any task class, so it's released through its slab. Its metadata outlives it.
+        auto* slab = PoolSlabHeader::fromAddress(this);
+        auto& meta = slab->metaOf(this);
+        slab->releaseItem(this);
+
+        // Waiting threads pin the task they wait for while they sleep, so only those tasks wake waiters up.
+        if (meta.pins.load() != 0) {
+            if (auto* taskGraph = TaskGraph::get()) {
+                taskGraph->notifyCompletion();
+            }
+        }
+    }
+}
+
+void Task::precede(Task* successor) {
+    link(createEdge(successor));
+}
+
+void Task::precede(PoolItemHandle<Task> predecessor, Task* successor) {
+    link(predecessor, createEdge(successor));
+}
+
+void Task::precede(std::initializer_list<PoolItemHandle<Task>> predecessors, Task* successor) {
+    // Every edge is allocated before any is linked, so a failure leaves the successor as it was. Until then the
+    // edges are kept in a list through their own successor lists.
+    Task* edges = nullptr;
+    try {
+        for (size_t i = 0; i < predecessors.size(); i++) {
+            auto* edge = createEdge(successor);
+            edge->next.store(edges, std::memory_order_relaxed);
+            edges = edge;
+        }
+    } catch (...) {
+        while (edges != nullptr) {
+            auto* edge = edges;
+            edges = edge->next.load(std::memory_order_relaxed);
+            cancelEdge(edge);
         }
 
-        if (next != nullptr) {
-            next->submit();
+        throw;
+    }
+
+    for (auto predecessor : predecessors) {
+        auto* edge = edges;
+        edges = edge->next.load(std::memory_order_relaxed);
+        link(predecessor, edge);
+    }
+}
+
+Task* Task::createEdge(Task* successor) {
+    auto* item = Worker::getTaskPool()->obtain(&EDGE_OPS);
+    if (item == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    // The count includes the dependency the successor holds on itself until it's submitted.
+    auto count = successor->dependencyCount.load(std::memory_order_relaxed);
+    do {
+        if (count > MAX_PREDECESSOR_COUNT) {
+            PoolSlabHeader::fromAddress(item)->releaseItem(item);
+            throw std::length_error("too many predecessors");
         }
+    } while (!successor->dependencyCount.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+
+    Task* edge = item->data();
+    edge->setData(successor);
+    return edge;
+}
+
+void Task::cancelEdge(Task* edge) {
+    // N.B. The successor hasn't been submitted, so this never releases its last dependency.
+    edge->getData<Task*>()->dependencyCount.fetch_sub(1, std::memory_order_relaxed);
+    PoolSlabHeader::fromAddress(edge)->releaseItem(edge);
+}
+
+void Task::dropEdge(Task* edge) {
+    auto* successor = edge->getData<Task*>();
+    PoolSlabHeader::fromAddress(edge)->releaseItem(edge);
+    successor->submit();
+}
 
-        auto* poolItem = PoolItem<Task>::fromData(this);
-        auto* pool = PoolAllocator<Task>::fromItem(poolItem);
-        pool->release(poolItem);
+void Task::link(PoolItemHandle<Task>& predecessor, Task* edge) {
+    // N.B. The edge is allocated before the predecessor is pinned, it may then reuse the predecessor's slot only
+    // if the predecessor has already been released, which the pin detects.
+    if (!predecessor.pin()) {
+        dropEdge(edge);
+        return;
     }
+
+    predecessor->link(edge);
+    predecessor.unpin();
 }
 
-void Task::setTeardownFunc(TaskCallback inTeardownFn) {
-    teardownFn = inTeardownFn;
+void Task::link(Task* edge) {
+    auto* head = next.load(std::memory_order_acquire);
+    do {
+        if (head == finishedSuccessors()) {
+            // Already finished, there's nothing to wait for.
+            dropEdge(edge);
+            return;
+        }
+
+        edge->next.store(head, std::memory_order_relaxed);
+    } while (!next.compare_exchange_weak(head, edge, std::memory_order_release, std::memory_order_acquire));
+}
+
+TaskPriority Task::getPriority() const {
+    return priority;
+}
+
+bool Task::isNeededBy(const Task* task) const {
+    // N.B. This task hasn't finished, so neither have its ancestors, nor the tasks any of them hold back, and so
+    // on. Every task looked at is still alive.
+    std::array<const Task*, NEEDED_BY_SEARCH_LIMIT> pending {};
+    size_t pendingCount = 0;
+    size_t visitedCount = 0;
+    pending[pendingCount++] = this;
+
+    while (pendingCount > 0) {
+        for (auto* current = pending[--pendingCount]; current != nullptr; current = current->parent) {
+            if (current == task) {
+                return true;
+            }
+
+            if (++visitedCount == NEEDED_BY_SEARCH_LIMIT) {
+                return false;
+            }
+
+            auto* successor = current->next.load(std::memory_order_acquire);
+            while (successor != nullptr && successor != finishedSuccessors()) {
+                if (pendingCount == pending.size()) {
+                    return false;
+                }
+
+                if (successor->ops != &EDGE_OPS) {
+                    pending[pendingCount++] = successor;
+                    break;
+                }
+
+                pending[pendingCount++] = successor->getData<Task*>();
+                successor = successor->next.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    return false;
 }
 
 PoolItemHandle<Task> Task::submit() {
-    auto* worker = TaskGraph::getThreadWorker();
-    assert(worker != nullptr);
     PoolItemHandle<Task> handle(this);
-    worker->submit(handle);
+
+    // Submitting releases the dependency the task holds on itself. If that's the only one left, no predecessor
+    // can release the task concurrently, so there's no need for a read-modify-write.
+    if (dependencyCount.load(std::memory_order_acquire) != 1
+        && dependencyCount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return handle;
+    }
+
+    if (auto* worker = TaskGraph::getThreadWorker()) {
+        worker->submit(handle);
+    } else {
+        // Not a worker thread, hand the task over to workers through the injection queue.
+        auto* taskGraph = TaskGraph::get();
+        assert(taskGraph != nullptr);
+        taskGraph->submit(handle);
+    }
+
     return handle;
 }
 
@@ -71,12 +241,35 @@ PoolItemHandle<Task> TaskChainBuilder::submit() {
 }
 
 TaskGraph::TaskGraph(uint32_t numThreads)
-    :workers(numThreads) {
+    :TaskGraph(TaskGraphOptions { numThreads }) {
+}
+
+TaskGraph::TaskGraph(const TaskGraphOptions& options)
+    :workers(options.numThreads), injectionQueues {}, sharedTaskPools(Worker::TASK_POOL_SLAB_SIZE), sharedArena {},
+     idleEvent {}, waitEvent {}, searchingCount { 0 }, maxSearchingCount { options.maxSearchingWorkers } {
+    auto numThreads = options.numThreads;
     assert(numThreads > 0);
 
-    workers[0].start(0, numThreads, Worker::Mode::Foreground);
-    for (auto i = 1u; i < numThreads; i++) {
-        workers[i].start(i, numThreads, Worker::Mode::Background);
+    if (maxSearchingCount == 0) {
+        maxSearchingCount = std::max(1u, numThreads / 2);
+    }
+
+    std::unique_ptr<Topology> topology;
+    if (options.victimPolicy == VictimPolicy::Hierarchical) {
+        topology = std::make_unique<Topology>(Topology::read());
+    }
+
+    for (auto i = 0u; i < numThreads; i++) {
+        auto mode = i == 0 ? Worker::Mode::Foreground : Worker::Mode::Background;
+        VictimSelector victimSelector(options.victimPolicy, i, numThreads, topology.get());
+
+        // Background workers are pinned to the CPU the topology assigns them, the foreground thread is left
+        // alone and is assumed to be close to the first CPU.
+        int32_t cpu = topology != nullptr && mode == Worker::Mode::Background
+            ? (int32_t)topology->getWorkerCpu(i).id
+            : -1;
+
+        workers[i].start(this, i, mode, std::move(victimSelector), cpu, options.idlePolicy);
     }
 }
 
@@ -86,6 +279,9 @@ void TaskGraph::stop() {
         worker.stop();
     }
 
+    idleEvent.notifyAll();
+    waitEvent.notifyAll();
+
     // Wait for workers to actually finish.
     for (auto& worker : workers) {
         worker.join();
@@ -95,6 +291,109 @@ void TaskGraph::stop() {
     workers[0].clear();
 }
 
+void TaskGraph::submit(PoolItemHandle<Task>& task) {
+    // The queue is only full if workers are falling behind, give them a chance to catch up.
+    auto& injectionQueue = injectionQueues[(size_t)task->getPriority()];
+    while (!injectionQueue.push(*task)) {
+        std::this_thread::yield();
+    }
+
+    notifyWork();
+}
+
+void TaskGraph::wait(PoolItemHandle<Task>& task) {
+    // Not a worker thread, there's no queue to help with. Yield for a while in case the task is about to finish
+    // and sleep otherwise.
+    for (auto i = 0u; i < Worker::MIN_SPIN_ROUNDS && task.valid(); i++) {
+        std::this_thread::yield();
+    }
+
+    // The pin asks the thread finishing the task to wake up waiters, see `Task::finish()`.
+    if (!task.pin()) {
+        return;
+    }
+
+    while (task.valid()) {
+        auto key = waitEvent.prepareWait();
+        if (!task.valid()) {
+            waitEvent.cancelWait();
+            break;
+        }
+
+        waitEvent.wait(key);
+    }
+
+    task.unpin();
+}
+
+void TaskGraph::notifyWork() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Searching workers will find the task, and wake up another worker when they do.
+    if (searchingCount.load(std::memory_order_relaxed) > 0) {
+        return;
+    }
+
+    // Prefer waking an idle worker, threads blocked in `wait()` can help only if there are none.
+    if (idleEvent.waiterCount() > 0) {
+        idleEvent.notify(1);
+    } else if (waitEvent.waiterCount() > 0) {
+        waitEvent.notifyAll();
+    }
+}
+
+void TaskGraph::notifyCompletion() {
+    // N.B. No fence is needed here, releasing the task has bumped its version with a sequentially consistent
+    // read-modify-write, which the sequentially consistent load in `waiterCount()` can't be reordered with.
+    // All waiters share the event, so every one of them wakes up to check its own task. That's only paid for
+    // completions of tasks someone waits for, as others don't get here.
+    if (waitEvent.waiterCount() > 0) {
+        waitEvent.notifyAll();
+    }
+}
+
+bool TaskGraph::tryStartSearching() {
+    auto count = searchingCount.load(std::memory_order_relaxed);
+    while (count < maxSearchingCount) {
+        if (searchingCount.compare_exchange_weak(count, count + 1, std::memory_order_seq_cst)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TaskGraph::stopSearching(bool foundWork) {
+    auto previous = searchingCount.fetch_sub(1, std::memory_order_seq_cst);
+
+    // The last searcher found work, so there's likely more of it around. Wake up a worker to keep searching.
+    if (foundWork && previous == 1) {
+        notifyWork();
+    }
+}
+
+EventCount& TaskGraph::getIdleEvent() {
+    return idleEvent;
+}
+
+EventCount& TaskGraph::getWaitEvent() {
+    return waitEvent;
+}
+
+Task* TaskGraph::fetchInjectedTask(TaskPriority priority) {
+    return injectionQueues[(size_t)priority].pop();
+}
+
+TaskPools* TaskGraph::getSharedTaskPools() {
+    return &sharedTaskPools;
+}
+
+void* TaskGraph::allocateSharedPayload(size_t size, size_t alignment) {
+    // Unlike task pools, arenas can only be allocated from by one thread at a time.
+    std::lock_guard lock { sharedArenaMutex };
+    return sharedArena.allocate(size, alignment);
+}
+
 Worker* TaskGraph::getWorker(std::thread::id id) {
     for (auto& worker : workers) {
         if (worker.id == id) {
@@ -118,6 +417,11 @@ void TaskGraph::init(uint32_t numThreads) {
     gInstance = std::make_unique<TaskGraph>(numThreads);
 }
 
+void TaskGraph::init(const TaskGraphOptions& options) {
+    assert(!gInstance);
+    gInstance = std::make_unique<TaskGraph>(options);
+}
+
 void TaskGraph::shutdown() {
     assert(gInstance);
     gInstance->stop();
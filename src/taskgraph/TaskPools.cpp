@@ -0,0 +1,24 @@
+#include "taskgraph/TaskPools.h"
+#include "taskgraph/TaskGraph.h"
+
+namespace {
+    constexpr size_t getSlabSize(size_t slabSize, size_t lineCount) {
+        size_t size = 1u;
+        while (size * 2u * lineCount <= slabSize) {
+            size *= 2u;
+        }
+
+        return size;
+    }
+}
+
+TaskPools::TaskPools(size_t slabSize)
+    :pools { slabSize, getSlabSize(slabSize, 2), getSlabSize(slabSize, 3),
+             getSlabSize(slabSize, MAX_TASK_LINE_COUNT) } {
+}
+
+void TaskPools::setOwner(std::thread::id thread) {
+    std::apply([&](auto& ...pool) {
+        (pool.setOwner(thread), ...);
+    }, pools);
+}
@@ -1,47 +1,70 @@
+#include <algorithm>
 #include "taskgraph/TaskQueue.h"
 
+// Memory ordering follows the C11 Chase-Lev deque by Lê, Pop, Cohen & Zappa Nardelli, "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (PPoPP 2013). The only deviation is that `push` publishes `bottom`
+// with a release store instead of a release fence followed by a relaxed store, which is equivalent here and
+// is understood by ThreadSanitizer.
+
+TaskQueue::Buffer::Buffer(int64_t inCapacity)
+    :capacity { inCapacity }, mask { inCapacity - 1 }, tasks { new std::atomic<Task*>[inCapacity] } {
+}
+
+TaskQueue::TaskQueue()
+    :top { 0 }, bottom { 0 } {
+    buffers.push_back(std::make_unique<Buffer>(INITIAL_CAPACITY));
+    buffer = buffers.back().get();
+}
+
 void TaskQueue::push(Task* task) {
-    int b = bottom;
-    tasks[b & TASK_LOOKUP_MASK] = task;
-    bottom = b + 1;
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    Buffer* buf = buffer.load(std::memory_order_relaxed);
+
+    if (b - t > buf->capacity - 1) {
+        buf = grow(buf, t, b);
+    }
+
+    buf->put(b, task);
+    bottom.store(b + 1, std::memory_order_release);
 }
 
 Task* TaskQueue::pop() {
-    int b = std::max(0, bottom - 1);
-    bottom = b;
-    int t = top;
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    Buffer* buf = buffer.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
 
     if (t <= b) {
-        auto* task = tasks[b & TASK_LOOKUP_MASK];
+        auto* task = buf->get(b);
         if (t != b) {
             return task;
         }
 
-        auto tExpected = t;
-        auto tDesired = t + 1;
-
-        if (!top.compare_exchange_strong(tExpected, tDesired)) {
+        // Last item in the queue, race against thieves for it.
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
             task = nullptr;
         }
 
-        bottom = t + 1;
+        bottom.store(b + 1, std::memory_order_relaxed);
         return task;
     }
 
-    bottom = t;
+    bottom.store(b + 1, std::memory_order_relaxed);
     return nullptr;
 }
 
 Task* TaskQueue::steal() {
-    int t = top;
-    int b = bottom;
-    if (t < b) {
-        auto* task = tasks[t & TASK_LOOKUP_MASK];
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
 
-        auto tExpected = t;
-        auto tDesired = t + 1;
+    if (t < b) {
+        Buffer* buf = buffer.load(std::memory_order_acquire);
+        auto* task = buf->get(t);
 
-        if (!top.compare_exchange_strong(tExpected, tDesired)) {
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
             return nullptr;
         }
 
@@ -51,6 +74,78 @@ Task* TaskQueue::steal() {
     return nullptr;
 }
 
-int TaskQueue::size() {
-    return std::max(0, bottom - top);
+Task* TaskQueue::stealBatch(TaskQueue& destination) {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b) {
+        return nullptr;
+    }
+
+    // Steal half of the queue, rounding up so that the last task can be stolen as well.
+    int64_t batchSize = std::min((b - t + 1) / 2, MAX_STEAL_BATCH_SIZE);
+
+    Buffer* buf = buffer.load(std::memory_order_acquire);
+    auto* first = buf->get(t);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+
+    // N.B. The owner pops from the bottom without a CAS as long as it sees more than one task in the queue,
+    // so claiming the whole batch with a single CAS on `top` could hand out the same task twice. Each task
+    // is claimed with its own CAS instead, re-reading `bottom` in between, and the batch is published to
+    // thieves of `destination` with a single store once it's complete.
+    int64_t destTop = destination.top.load(std::memory_order_acquire);
+    int64_t destBottom = destination.bottom.load(std::memory_order_relaxed);
+    Buffer* destBuffer = destination.buffer.load(std::memory_order_relaxed);
+
+    for (auto i = 1; i < batchSize; i++) {
+        t++;
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            break;
+        }
+
+        buf = buffer.load(std::memory_order_acquire);
+        auto* task = buf->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            break;
+        }
+
+        // `destTop` may be stale, which can only overestimate the number of queued tasks.
+        if (destBottom - destTop > destBuffer->capacity - 1) {
+            destBuffer = destination.grow(destBuffer, destTop, destBottom);
+        }
+
+        destBuffer->put(destBottom, task);
+        destBottom++;
+    }
+
+    destination.bottom.store(destBottom, std::memory_order_release);
+    return first;
+}
+
+size_t TaskQueue::size() const {
+    int64_t t = top.load(std::memory_order_relaxed);
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    return b > t ? (size_t)(b - t) : 0;
+}
+
+size_t TaskQueue::capacity() const {
+    return (size_t)buffer.load(std::memory_order_relaxed)->capacity;
+}
+
+TaskQueue::Buffer* TaskQueue::grow(Buffer* oldBuffer, int64_t t, int64_t b) {
+    buffers.push_back(std::make_unique<Buffer>(oldBuffer->capacity * 2));
+    auto* newBuffer = buffers.back().get();
+
+    for (auto i = t; i < b; i++) {
+        newBuffer->put(i, oldBuffer->get(i));
+    }
+
+    buffer.store(newBuffer, std::memory_order_release);
+    return newBuffer;
 }
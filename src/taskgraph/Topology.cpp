@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "taskgraph/Topology.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace {
+    const std::string CPU_PATH = "/sys/devices/system/cpu/cpu";
+
+    int32_t readGroup(const std::string& path) {
+        // Both plain ids and CPU lists (e.g. `0-3,8-11`) start with the lowest number in the group.
+        std::ifstream file(path);
+        int32_t value = -1;
+        if (!(file >> value)) {
+            return -1;
+        }
+
+        return value;
+    }
+
+    int32_t readCacheGroup(uint32_t cpu, int32_t level) {
+        for (auto index = 0u;; index++) {
+            auto cachePath = CPU_PATH + std::to_string(cpu) + "/cache/index" + std::to_string(index);
+            auto cacheLevel = readGroup(cachePath + "/level");
+            if (cacheLevel < 0) {
+                return -1;
+            }
+
+            if (cacheLevel == level) {
+                return readGroup(cachePath + "/shared_cpu_list");
+            }
+        }
+    }
+
+    std::vector<uint32_t> getAllowedCpus() {
+        std::vector<uint32_t> ids;
+
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (auto cpu = 0u; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &set)) {
+                    ids.push_back(cpu);
+                }
+            }
+        }
+#endif
+
+        if (ids.empty()) {
+            auto count = std::max(1u, std::thread::hardware_concurrency());
+            for (auto cpu = 0u; cpu < count; cpu++) {
+                ids.push_back(cpu);
+            }
+        }
+
+        return ids;
+    }
+}
+
+Topology::Topology(std::vector<Cpu> inCpus)
+    :cpus { std::move(inCpus) } {
+    assert(!cpus.empty());
+}
+
+Topology Topology::read() {
+    std::vector<Cpu> cpus;
+
+    for (auto id : getAllowedCpus()) {
+        auto topologyPath = CPU_PATH + std::to_string(id) + "/topology";
+        cpus.push_back({
+            id,
+            readCacheGroup(id, 2),
+            readCacheGroup(id, 3),
+            readGroup(topologyPath + "/physical_package_id")
+        });
+    }
+
+    return Topology(std::move(cpus));
+}
+
+size_t Topology::getCpuCount() const {
+    return cpus.size();
+}
+
+const Topology::Cpu& Topology::getWorkerCpu(size_t workerIndex) const {
+    return cpus[workerIndex % cpus.size()];
+}
+
+uint32_t Topology::distance(size_t workerA, size_t workerB) const {
+    const auto& a = getWorkerCpu(workerA);
+    const auto& b = getWorkerCpu(workerB);
+
+    if (a.id == b.id || (a.l2Group >= 0 && a.l2Group == b.l2Group)) {
+        return SHARED_L2_DISTANCE;
+    } else if (a.l3Group >= 0 && a.l3Group == b.l3Group) {
+        return SHARED_L3_DISTANCE;
+    } else if (a.package == b.package) {
+        return SAME_PACKAGE_DISTANCE;
+    } else {
+        return REMOTE_DISTANCE;
+    }
+}
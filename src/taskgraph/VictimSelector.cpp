@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cassert>
+#include "taskgraph/Topology.h"
+#include "taskgraph/VictimSelector.h"
+
+VictimSelector::VictimSelector()
+    :policy { VictimPolicy::Linear }, rngState { 1 } {
+}
+
+VictimSelector::VictimSelector(VictimPolicy inPolicy, size_t workerIndex, size_t workerCount,
+    const Topology* topology)
+    :policy { inPolicy }, rngState { 0x9e3779b9u * (uint32_t)(workerIndex + 1) | 1u } {
+    for (auto i = 1u; i < workerCount; i++) {
+        victims.push_back((uint32_t)((workerIndex + i) % workerCount));
+    }
+
+    if (policy == VictimPolicy::Hierarchical && topology != nullptr) {
+        std::stable_sort(victims.begin(), victims.end(), [&](uint32_t a, uint32_t b) {
+            return topology->distance(workerIndex, a) < topology->distance(workerIndex, b);
+        });
+
+        for (auto i = 0u; i < victims.size(); i++) {
+            bool groupEnd = i + 1 == victims.size()
+                || topology->distance(workerIndex, victims[i]) != topology->distance(workerIndex, victims[i + 1]);
+            if (groupEnd) {
+                groupEnds.push_back(i + 1);
+            }
+        }
+    } else {
+        groupEnds.push_back((uint32_t)victims.size());
+    }
+
+    groupOffsets.resize(groupEnds.size(), 0);
+}
+
+void VictimSelector::beginScan() {
+    if (policy == VictimPolicy::Linear) {
+        return;
+    }
+
+    uint32_t groupBegin = 0;
+    for (auto i = 0u; i < groupEnds.size(); i++) {
+        groupOffsets[i] = nextRandom(groupEnds[i] - groupBegin);
+        groupBegin = groupEnds[i];
+    }
+}
+
+void VictimSelector::onSteal(size_t attempt) {
+    if (policy != VictimPolicy::Linear) {
+        return;
+    }
+
+    // Start the next scan from the worker tasks were stolen from.
+    assert(groupOffsets.size() == 1);
+    auto pos = (uint32_t)attempt + groupOffsets[0];
+    if (pos >= victims.size()) {
+        pos -= (uint32_t)victims.size();
+    }
+
+    groupOffsets[0] = pos;
+}
+
+uint32_t VictimSelector::nextRandom(uint32_t bound) {
+    // xorshift32, mapped to [0, bound) with a multiplication instead of a division.
+    rngState ^= rngState << 13u;
+    rngState ^= rngState >> 17u;
+    rngState ^= rngState << 5u;
+    return (uint32_t)(((uint64_t)rngState * bound) >> 32u);
+}
@@ -1,10 +1,19 @@
+#include <algorithm>
 #include <cassert>
 #include "taskgraph/Worker.h"
 #include "taskgraph/TaskGraph.h"
+#include "taskgraph/utils.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 Worker::Worker()
-    :pool(TASK_POOL_SIZE), queue {}, id { std::this_thread::get_id() }, mode { Mode::Foreground },
-     state { State::Idle }, stealIndex { 0 }, workerCount { 0 } {
+    :id { std::this_thread::get_id() }, state { State::Idle }, queues {}, mode { Mode::Foreground },
+     pools(TASK_POOL_SLAB_SIZE), arena {}, taskGraph { nullptr }, index { 0 }, fetchCount { 0 }, victimSelector {},
+     cpu { -1 }, idlePolicy { IdlePolicy::Park }, spinRounds { MIN_SPIN_ROUNDS }, waitDepth { 0 },
+     waitScanCounts {} {
 }
 
 Worker::~Worker() {
@@ -13,14 +22,19 @@ Worker::~Worker() {
     }
 }
 
-void Worker::start(size_t inIndex, size_t inWorkerCount, Mode inMode) {
+void Worker::start(TaskGraph* inTaskGraph, size_t inIndex, Mode inMode, VictimSelector inVictimSelector,
+    int32_t inCpu, IdlePolicy inIdlePolicy) {
+    taskGraph = inTaskGraph;
     mode = inMode;
-    stealIndex = inIndex;
-    workerCount = inWorkerCount;
+    index = inIndex;
+    victimSelector = std::move(inVictimSelector);
+    cpu = inCpu;
+    idlePolicy = inIdlePolicy;
 
     if (mode == Mode::Foreground) {
         assert(gThreadWorker == nullptr);
         gThreadWorker = this;
+        pools.setOwner(id);
     } else {
         thread = std::move(std::thread(&Worker::run, this));
     }
@@ -37,25 +51,51 @@ void Worker::join() {
 }
 
 void Worker::submit(PoolItemHandle<Task>& task) {
-    queue.push(*task);
+    queues[(size_t)task->getPriority()].push(*task);
+    taskGraph->notifyWork();
 }
 
 void Worker::wait(PoolItemHandle<Task>& task) {
-    assert(mode == Mode::Foreground);
+    // Background workers are already running, and waits can be nested in tasks run while waiting.
+    bool outermost = mode == Mode::Foreground && waitDepth == 0;
+    if (outermost) {
+        state = State::Running;
+    }
 
-    state = State::Running;
-    while (task.valid()) {
-        if (Task* nextTask = fetchTask()) {
-            nextTask->run();
+    waitDepth++;
 
-#if DEBUG
-            tasksCompleted++;
-#endif
-        } else {
-            std::this_thread::yield();
+    // The pin asks the thread finishing the task to wake up waiters, see `Task::finish()`. It also keeps the
+    // task's slot from being reused, so tasks can be compared to it while waiting.
+    bool pinned = task.pin();
+    auto* waitedTask = *task;
+
+    // Running a task or sleeping may change the local queues, so they're looked through again afterwards.
+    uint32_t idleRounds = 0;
+    resetWaitScan();
+    while (pinned && task.valid()) {
+        if (Task* nextTask = fetchWaitTask(waitedTask)) {
+            execute(nextTask, idleRounds);
+            resetWaitScan();
+        } else if (isWaitScanDone() && !backoff(idleRounds)) {
+            park(taskGraph->getWaitEvent(), [&]() {
+                return !task.valid();
+            }, [&]() {
+                return fetchWaitTask(waitedTask);
+            });
+            idleRounds = 0;
+            resetWaitScan();
         }
     }
-    state = State::Idle;
+
+    if (pinned) {
+        task.unpin();
+    }
+
+    waitDepth--;
+
+    if (outermost) {
+        state = State::Idle;
+    }
 }
 
 void Worker::clear() {
@@ -69,42 +109,199 @@ void Worker::clear() {
 
 void Worker::run() {
     gThreadWorker = this;
-    id = thread.get_id();
+    id = std::this_thread::get_id();
+    pools.setOwner(id);
+    pinToCpu();
 
     if (state == State::Idle) {
         state = State::Running;
     }
 
+    auto shouldWake = [&]() {
+        return state != State::Running;
+    };
+
+    // Workers which weren't searching only look at their own queue and the injection queues before sleeping,
+    // which keeps the number of workers scanning other workers' queues bounded.
+    auto fetchLocal = [&]() {
+        return fetchTask(false);
+    };
+
+    // Searchers which gave up look everywhere once more, pushers may have skipped waking a worker up while they
+    // were still searching.
+    auto fetch = [&]() {
+        return fetchTask();
+    };
+
+    // Only a limited number of idle workers search other workers' queues for tasks at a time, the rest sleep.
+    bool searching = false;
+    uint32_t idleRounds = 0;
+
     while (state == State::Running) {
-        if (auto* nextTask = fetchTask()) {
-            nextTask->run();
+        if (auto* nextTask = fetchTask(searching)) {
+            if (searching) {
+                searching = false;
+                taskGraph->stopSearching(true);
+            }
 
-#if DEBUG
-            tasksCompleted++;
-#endif
-        } else {
-            std::this_thread::yield();
+            execute(nextTask, idleRounds);
+        } else if (!searching) {
+            searching = taskGraph->tryStartSearching();
+
+            // Enough workers are searching already, they will wake this one up if they find more work.
+            if (!searching) {
+                if (idlePolicy == IdlePolicy::Spin) {
+                    std::this_thread::yield();
+                } else {
+                    park(taskGraph->getIdleEvent(), shouldWake, fetchLocal);
+                }
+            }
+        } else if (!backoff(idleRounds)) {
+            searching = false;
+            taskGraph->stopSearching(false);
+
+            park(taskGraph->getIdleEvent(), shouldWake, fetch);
+            idleRounds = 0;
         }
     }
 
+    if (searching) {
+        taskGraph->stopSearching(false);
+    }
+
     state = State::Idle;
     gThreadWorker = nullptr;
 }
 
-Task* Worker::fetchTask() {
+void Worker::execute(Task* task, uint32_t& idleRounds) {
+    // Finding work while spinning means spinning pays off, so spin for longer next time.
+    if (idleRounds > 0) {
+        spinRounds = std::min(spinRounds * 2, MAX_SPIN_ROUNDS);
+        idleRounds = 0;
+    }
+
+    task->run();
+
+#if DEBUG
+    tasksCompleted++;
+#endif
+}
+
+bool Worker::backoff(uint32_t& idleRounds) {
+    if (idleRounds < spinRounds) {
+        auto pauses = 1u << std::min(idleRounds, MAX_BACKOFF_SHIFT);
+        for (auto i = 0u; i < pauses; i++) {
+            utils::cpuRelax();
+        }
+
+        idleRounds++;
+        return true;
+    }
+
+    if (idlePolicy == IdlePolicy::Spin) {
+        std::this_thread::yield();
+        return true;
+    }
+
+    return false;
+}
+
+template<typename F, typename G>
+void Worker::park(EventCount& event, F&& shouldWake, G&& fetch) {
+    auto key = event.prepareWait();
+
+    // Re-check for work after announcing the wait, tasks submitted from now on will wake the worker up.
+    if (shouldWake()) {
+        event.cancelWait();
+        return;
+    }
+
+    uint32_t idleRounds = 0;
+    if (auto* task = fetch()) {
+        event.cancelWait();
+        execute(task, idleRounds);
+        return;
+    }
+
+    // Spinning didn't pay off, spin for less time next time.
+    spinRounds = std::max(spinRounds / 2, MIN_SPIN_ROUNDS);
+    event.wait(key);
+}
+
+void Worker::pinToCpu() {
+#if defined(__linux__)
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+}
+
+bool Worker::hasLocalTasks() const {
+    for (auto& queue : queues) {
+        if (queue.size() > 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Task* Worker::fetchTask(bool searching) {
+    bool lowestFirst = ++fetchCount % PRIORITY_STARVATION_LIMIT == 0;
+
+    // Workers with tasks of their own still steal tasks of higher priority, idle ones only steal while searching.
+    bool steal = searching || hasLocalTasks();
+
+    for (auto i = 0u; i < TASK_PRIORITY_COUNT; i++) {
+        auto priority = (TaskPriority)(lowestFirst ? TASK_PRIORITY_COUNT - 1 - i : i);
+        if (auto* task = fetchTask(priority, steal)) {
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+Task* Worker::fetchTask(TaskPriority priority, bool steal) {
+    auto& queue = queues[(size_t)priority];
+
     Task* task = queue.pop();
     if (task != nullptr) {
         return task;
     }
 
-    auto* taskGraph = TaskGraph::get();
     if (taskGraph != nullptr) {
+        task = taskGraph->fetchInjectedTask(priority);
+        if (task != nullptr || !steal) {
+            return task;
+        }
+
         auto& workers = taskGraph->workers;
-        for (auto i = 0u; i < workerCount; i++) {
-            auto idx = (i + stealIndex) % workerCount;
-            task = workers[idx].queue.steal();
+        victimSelector.beginScan();
+
+        for (auto i = 0u; i < victimSelector.victimCount(); i++) {
+            auto& victimQueue = workers[victimSelector.victim(i)].queues[(size_t)priority];
+
+            // Skip empty queues without paying for the fence in `stealBatch`. The relaxed size may miss a task
+            // which was just pushed, spinning workers look again anyway. Workers about to sleep fetch after the
+            // fence in `EventCount::prepareWait()`, which pairs with the fence notifiers go through after pushing:
+            // either the size includes the task, or the notifier sees the waiter and wakes it up.
+            if (victimQueue.size() == 0) {
+                continue;
+            }
+
+            task = victimQueue.stealBatch(queue);
             if (task != nullptr) {
-                stealIndex = idx;
+                victimSelector.onSteal(i);
+
+                // More tasks were stolen than this worker is about to run, let another worker help with them.
+                if (queue.size() > 0) {
+                    taskGraph->notifyWork();
+                }
+
                 return task;
             }
         }
@@ -113,11 +310,104 @@ Task* Worker::fetchTask() {
     return nullptr;
 }
 
+Task* Worker::fetchWaitTask(Task* waitedTask) {
+    // Subtasks of the waited task are usually the latest tasks pushed to the local queues, so they're taken first.
+    if (waitDepth <= MAX_WAIT_DEPTH) {
+        return fetchTask();
+    }
+
+    // Too deep to run tasks which may wait themselves, only tasks the waited task needs are taken from the local
+    // queues. The latest task is the most likely one. Others are looked at a few at a time by moving the oldest
+    // tasks to the bottom of their queue, so other workers can still steal all but one of them meanwhile.
+    bool scanning = !isWaitScanDone();
+    auto scanCount = MAX_WAIT_SCAN;
+    for (auto i = 0u; i < TASK_PRIORITY_COUNT; i++) {
+        auto& queue = queues[i];
+        if (auto* task = queue.pop()) {
+            if (task->isNeededBy(waitedTask)) {
+                return task;
+            }
+
+            queue.push(task);
+        }
+
+        for (; scanCount > 0 && waitScanCounts[i] > 0; scanCount--) {
+            waitScanCounts[i]--;
+
+            auto* task = queue.steal();
+            if (task == nullptr) {
+                waitScanCounts[i] = 0;
+                break;
+            }
+
+            if (task->isNeededBy(waitedTask)) {
+                return task;
+            }
+
+            queue.push(task);
+        }
+    }
+
+    // Tasks submitted by threads which aren't workers, such as predecessors of the waited task, are moved to the
+    // local queues when the waited task doesn't need them.
+    bool movedTasks = false;
+    for (auto i = 0u; i < TASK_PRIORITY_COUNT; i++) {
+        if (auto* task = taskGraph->fetchInjectedTask((TaskPriority)i)) {
+            if (task->isNeededBy(waitedTask)) {
+                return task;
+            }
+
+            queues[i].push(task);
+            movedTasks = true;
+        }
+    }
+
+    // Other workers have to take the tasks left in the local queues, they're told once the queues have been looked
+    // through rather than every round.
+    if ((movedTasks || (scanning && isWaitScanDone())) && hasLocalTasks()) {
+        taskGraph->notifyWork();
+    }
+
+    return nullptr;
+}
+
+void Worker::resetWaitScan() {
+    for (auto i = 0u; i < TASK_PRIORITY_COUNT; i++) {
+        waitScanCounts[i] = waitDepth > MAX_WAIT_DEPTH ? queues[i].size() : 0;
+    }
+}
+
+bool Worker::isWaitScanDone() const {
+    for (auto count : waitScanCounts) {
+        if (count > 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 Worker* Worker::getThreadWorker() {
     return gThreadWorker;
 }
 
-PoolAllocator<Task>* Worker::getTaskPool() {
-    assert(gThreadWorker != nullptr);
-    return &gThreadWorker->pool;
+TaskPools* Worker::getTaskPools() {
+    if (gThreadWorker != nullptr) {
+        return &gThreadWorker->pools;
+    }
+
+    // Threads that aren't workers allocate from the pools shared between them.
+    auto* taskGraph = TaskGraph::get();
+    assert(taskGraph != nullptr);
+    return taskGraph->getSharedTaskPools();
+}
+
+void* Worker::allocatePayload(size_t size, size_t alignment) {
+    if (gThreadWorker != nullptr) {
+        return gThreadWorker->arena.allocate(size, alignment);
+    }
+
+    auto* taskGraph = TaskGraph::get();
+    assert(taskGraph != nullptr);
+    return taskGraph->allocateSharedPayload(size, alignment);
 }
@@ -8,10 +8,18 @@ void tasks::init(uint32_t numThreads) {
     TaskGraph::init(numThreads);
 }
 
+void tasks::init(const Options& options) {
+    TaskGraph::init(options);
+}
+
 void tasks::shutdown() {
     TaskGraph::shutdown();
 }
 
 void tasks::wait(TaskHandle& task) {
-    TaskGraph::getThreadWorker()->wait(task);
+    if (auto* worker = TaskGraph::getThreadWorker()) {
+        worker->wait(task);
+    } else {
+        TaskGraph::get()->wait(task);
+    }
 }
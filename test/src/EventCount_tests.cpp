@@ -0,0 +1,83 @@
+#include <thread>
+#include <catch2/catch.hpp>
+#include <taskgraph/EventCount.h>
+
+TEST_CASE("Cancelled wait", "[EventCount]") {
+    EventCount event;
+
+    auto key = event.prepareWait();
+    REQUIRE(event.waiterCount() == 1);
+
+    event.cancelWait();
+    REQUIRE(event.waiterCount() == 0);
+
+    // Notifying without waiters is a no-op.
+    event.notify(1);
+    REQUIRE(event.prepareWait() == key);
+    event.cancelWait();
+}
+
+TEST_CASE("Notification before wait isn't lost", "[EventCount]") {
+    EventCount event;
+
+    auto key = event.prepareWait();
+    event.notifyAll();
+
+    // Returns immediately since the notification happened after `prepareWait()`.
+    event.wait(key);
+    REQUIRE(event.waiterCount() == 0);
+}
+
+TEST_CASE("Wait & notify", "[EventCount]") {
+    static constexpr size_t ROUND_COUNT = 1000;
+    static constexpr size_t WAITER_COUNT = 3;
+
+    EventCount event;
+    std::atomic<size_t> produced { 0 };
+    std::atomic<size_t> consumed { 0 };
+    std::vector<std::thread> waiters;
+
+    for (auto i = 0u; i < WAITER_COUNT; i++) {
+        waiters.emplace_back([&]() {
+            while (true) {
+                // Claim an item if there's one, sleep until one is produced otherwise.
+                auto available = produced.load();
+                auto taken = consumed.load();
+                if (taken == ROUND_COUNT) {
+                    break;
+                }
+
+                if (taken < available) {
+                    consumed.compare_exchange_strong(taken, taken + 1);
+                    continue;
+                }
+
+                auto key = event.prepareWait();
+                if (consumed.load() < produced.load() || consumed.load() == ROUND_COUNT) {
+                    event.cancelWait();
+                    continue;
+                }
+
+                event.wait(key);
+            }
+        });
+    }
+
+    for (auto i = 0u; i < ROUND_COUNT; i++) {
+        produced++;
+        event.notify(1);
+    }
+
+    while (consumed < ROUND_COUNT) {
+        event.notifyAll();
+        std::this_thread::yield();
+    }
+
+    event.notifyAll();
+    for (auto& waiter : waiters) {
+        waiter.join();
+    }
+
+    REQUIRE(consumed == ROUND_COUNT);
+    REQUIRE(event.waiterCount() == 0);
+}
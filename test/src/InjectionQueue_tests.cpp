@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <thread>
+#include <catch2/catch.hpp>
+#include <taskgraph/TaskGraph.h>
+
+TEST_CASE("Queue functionality", "[InjectionQueue]") {
+    InjectionQueue queue;
+    std::vector<Task> tasks { 3 };
+
+    REQUIRE(queue.size() == 0);
+    REQUIRE(queue.pop() == nullptr);
+
+    for (auto& task : tasks) {
+        REQUIRE(queue.push(&task));
+    }
+
+    REQUIRE(queue.size() == 3);
+
+    // N.B. FIFO
+    REQUIRE(queue.pop() == &tasks[0]);
+    REQUIRE(queue.pop() == &tasks[1]);
+    REQUIRE(queue.pop() == &tasks[2]);
+    REQUIRE(queue.pop() == nullptr);
+}
+
+TEST_CASE("Full queue", "[InjectionQueue]") {
+    InjectionQueue queue;
+    Task task;
+
+    size_t pushed = 0;
+    while (queue.push(&task)) {
+        pushed++;
+    }
+
+    REQUIRE(pushed > 0);
+    REQUIRE(queue.size() == pushed);
+    REQUIRE(queue.pop() == &task);
+    REQUIRE(queue.push(&task));
+    REQUIRE(!queue.push(&task));
+}
+
+TEST_CASE("Multiple producers & consumers", "[InjectionQueue]") {
+    static constexpr size_t TASKS_PER_PRODUCER = 50000;
+    static constexpr size_t PRODUCER_COUNT = 3;
+    static constexpr size_t CONSUMER_COUNT = 3;
+    static constexpr size_t TASK_COUNT = TASKS_PER_PRODUCER * PRODUCER_COUNT;
+
+    InjectionQueue queue;
+    std::vector<Task> tasks { TASK_COUNT };
+    std::vector<std::atomic<int>> hits(TASK_COUNT);
+    std::atomic<size_t> consumed { 0 };
+    std::vector<std::thread> threads;
+
+    for (auto i = 0u; i < PRODUCER_COUNT; i++) {
+        threads.emplace_back([&, i]() {
+            for (auto j = 0u; j < TASKS_PER_PRODUCER; j++) {
+                while (!queue.push(&tasks[i * TASKS_PER_PRODUCER + j])) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (auto i = 0u; i < CONSUMER_COUNT; i++) {
+        threads.emplace_back([&]() {
+            while (consumed < TASK_COUNT) {
+                if (auto* task = queue.pop()) {
+                    hits[task - tasks.data()]++;
+                    consumed++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto consumedOnce = std::count_if(hits.begin(), hits.end(), [](auto& hit) { return hit == 1; });
+    REQUIRE(consumedOnce == TASK_COUNT);
+}
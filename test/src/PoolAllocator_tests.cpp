@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <array>
+#include <thread>
 #include <catch2/catch.hpp>
 #include <taskgraph/PoolAllocator.h>
 
@@ -25,7 +27,7 @@ TEST_CASE("Initial fill", "[AtomicPoolAllocator]") {
 }
 
 TEST_CASE("Obtain & release", "[PoolAllocator]") {
-    PoolAllocator<TestStruct> pool(MAX_ITEMS);
+    PoolAllocator<TestStruct> pool(MAX_ITEMS, MAX_ITEMS);
     std::vector<PoolItem<TestStruct>*> vec;
 
     PoolItem<TestStruct>* handle { nullptr };
@@ -58,7 +60,7 @@ TEST_CASE("Constructors & destructor", "[PoolAllocator]") {
         }
     };
 
-    PoolAllocator<CDTestStruct> pool(MAX_ITEMS);
+    PoolAllocator<CDTestStruct> pool(MAX_ITEMS, MAX_ITEMS);
     std::vector<PoolItem<CDTestStruct>*> vec;
 
     while (PoolItem<CDTestStruct>* handle = pool.obtain()) {
@@ -73,3 +75,227 @@ TEST_CASE("Constructors & destructor", "[PoolAllocator]") {
 
     REQUIRE(alive == 0);
 }
+
+TEST_CASE("Concurrent obtain & release", "[PoolAllocator]") {
+    static constexpr size_t THREAD_COUNT = 4;
+    static constexpr size_t ROUNDS = 20000;
+
+    struct OwnedStruct {
+        std::atomic<size_t> owner;
+    };
+
+    // Few items and many threads, so that items are popped and pushed back while others are mid-pop.
+    PoolAllocator<OwnedStruct> pool(THREAD_COUNT, THREAD_COUNT);
+    std::atomic<bool> duplicate { false };
+    std::vector<std::thread> threads;
+
+    for (auto t = 0u; t < THREAD_COUNT; t++) {
+        threads.emplace_back([&, t]() {
+            for (auto round = 0u; round < ROUNDS; round++) {
+                auto* item = pool.obtain();
+                if (item == nullptr) {
+                    continue;
+                }
+
+                size_t expected = 0;
+                if (!item->data()->owner.compare_exchange_strong(expected, t + 1)) {
+                    duplicate = true;
+                }
+
+                std::this_thread::yield();
+                item->data()->owner = 0;
+                pool.release(item);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    REQUIRE_FALSE(duplicate);
+    REQUIRE(pool.size() == THREAD_COUNT);
+
+    // Every item is still reachable from the free list exactly once.
+    std::vector<PoolItem<OwnedStruct>*> vec;
+    while (auto* item = pool.obtain()) {
+        vec.push_back(item);
+    }
+
+    REQUIRE(vec.size() == THREAD_COUNT);
+    std::sort(vec.begin(), vec.end());
+    REQUIRE(std::adjacent_find(vec.begin(), vec.end()) == vec.end());
+}
+
+TEST_CASE("Growth", "[PoolAllocator]") {
+    static constexpr size_t SLAB_SIZE = 16;
+    static constexpr size_t ITEM_COUNT = 100;
+
+    PoolAllocator<TestStruct> pool(SLAB_SIZE);
+    std::vector<PoolItem<TestStruct>*> vec;
+
+    for (auto i = 0u; i < ITEM_COUNT; i++) {
+        auto* item = pool.obtain();
+        REQUIRE(item != nullptr);
+        REQUIRE(PoolAllocator<TestStruct>::fromItem(item) == &pool);
+        vec.push_back(item);
+    }
+
+    REQUIRE(pool.capacity() == 7 * SLAB_SIZE);
+    REQUIRE(pool.growthCount() == 6);
+    REQUIRE(pool.size() == pool.capacity() - ITEM_COUNT);
+
+    std::sort(vec.begin(), vec.end());
+    REQUIRE(std::adjacent_find(vec.begin(), vec.end()) == vec.end());
+
+    for (auto* item : vec) {
+        pool.release(item);
+    }
+
+    REQUIRE(pool.size() == pool.capacity());
+}
+
+TEST_CASE("Growth up to maximum capacity", "[PoolAllocator]") {
+    static constexpr size_t SLAB_SIZE = 16;
+
+    PoolAllocator<TestStruct> pool(SLAB_SIZE, 40);
+    std::vector<PoolItem<TestStruct>*> vec;
+
+    while (auto* item = pool.obtain()) {
+        vec.push_back(item);
+    }
+
+    REQUIRE(vec.size() == 2 * SLAB_SIZE);
+    REQUIRE(pool.capacity() == 2 * SLAB_SIZE);
+    REQUIRE(pool.growthCount() == 1);
+
+    for (auto* item : vec) {
+        pool.release(item);
+    }
+}
+
+TEST_CASE("Concurrent growth", "[PoolAllocator]") {
+    static constexpr size_t THREAD_COUNT = 4;
+    static constexpr size_t ITEMS_PER_THREAD = 1000;
+
+    PoolAllocator<TestStruct> pool(16);
+    std::vector<std::vector<PoolItem<TestStruct>*>> obtained { THREAD_COUNT };
+    std::vector<std::thread> threads;
+
+    for (auto t = 0u; t < THREAD_COUNT; t++) {
+        threads.emplace_back([&, t]() {
+            for (auto i = 0u; i < ITEMS_PER_THREAD; i++) {
+                obtained[t].push_back(pool.obtain());
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<PoolItem<TestStruct>*> vec;
+    for (auto& items : obtained) {
+        vec.insert(vec.end(), items.begin(), items.end());
+    }
+
+    std::sort(vec.begin(), vec.end());
+    REQUIRE(vec.front() != nullptr);
+    REQUIRE(std::adjacent_find(vec.begin(), vec.end()) == vec.end());
+    REQUIRE(pool.size() == pool.capacity() - THREAD_COUNT * ITEMS_PER_THREAD);
+
+    for (auto* item : vec) {
+        pool.release(item);
+    }
+}
+
+TEST_CASE("Owned pool with remote releases", "[PoolAllocator]") {
+    static constexpr size_t THREAD_COUNT = 3;
+    static constexpr size_t ROUNDS = 200;
+
+    PoolAllocator<TestStruct> pool(MAX_ITEMS, MAX_ITEMS);
+    pool.setOwner(std::this_thread::get_id());
+
+    for (auto round = 0u; round < ROUNDS; round++) {
+        std::vector<PoolItem<TestStruct>*> vec;
+        while (auto* item = pool.obtain()) {
+            vec.push_back(item);
+        }
+
+        REQUIRE(vec.size() == MAX_ITEMS);
+        REQUIRE(pool.size() == 0);
+
+        // The owner releases some of the items itself, the rest are released by other threads.
+        std::vector<std::thread> threads;
+        for (auto t = 0u; t < THREAD_COUNT; t++) {
+            threads.emplace_back([&, t]() {
+                for (auto i = t + 1; i < vec.size(); i += THREAD_COUNT + 1) {
+                    pool.release(vec[i]);
+                }
+            });
+        }
+
+        for (auto i = 0u; i < vec.size(); i += THREAD_COUNT + 1) {
+            pool.release(vec[i]);
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        REQUIRE(pool.size() == MAX_ITEMS);
+    }
+
+    REQUIRE(pool.growthCount() == 0);
+}
+
+TEST_CASE("Cache line aligned items", "[PoolAllocator]") {
+    static constexpr auto LINE = std::hardware_destructive_interference_size;
+
+    PoolAllocator<TestStruct> pool(MAX_ITEMS, MAX_ITEMS);
+    std::vector<PoolItem<TestStruct>*> vec;
+
+    while (auto* item = pool.obtain()) {
+        REQUIRE((uintptr_t)item->data() % LINE == 0);
+        REQUIRE(PoolAllocator<TestStruct>::fromItem(item) == &pool);
+        vec.push_back(item);
+    }
+
+    REQUIRE(sizeof(PoolItem<TestStruct>) == LINE);
+
+    PoolItemHandle<TestStruct> handle(vec.front()->data());
+    REQUIRE(handle.valid());
+
+    for (auto* item : vec) {
+        pool.release(item);
+    }
+
+    REQUIRE_FALSE(handle.valid());
+}
+
+TEST_CASE("Pinned items", "[PoolAllocator]") {
+    PoolAllocator<TestStruct> pool(MAX_ITEMS, MAX_ITEMS);
+
+    auto* item = pool.obtain();
+    PoolItemHandle<TestStruct> handle(item->data());
+    REQUIRE(handle.pin());
+
+    // Released items stay out of the free list while pinned, and their handles can't be pinned anymore.
+    pool.release(item);
+    REQUIRE_FALSE(handle.valid());
+    REQUIRE(pool.size() == MAX_ITEMS - 1);
+
+    REQUIRE_FALSE(handle.pin());
+
+    handle.unpin();
+    REQUIRE(pool.size() == MAX_ITEMS);
+
+    // Items released while unpinned go straight back to the pool.
+    item = pool.obtain();
+    PoolItemHandle<TestStruct> other(item->data());
+    REQUIRE(other.pin());
+    other.unpin();
+    pool.release(item);
+    REQUIRE(pool.size() == MAX_ITEMS);
+    REQUIRE_FALSE(other.pin());
+}
@@ -0,0 +1,286 @@
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <catch2/catch.hpp>
+#include <tasks.h>
+#include <taskgraph/TaskArena.h>
+
+namespace {
+    std::atomic<bool> gCountAllocations { false };
+    std::atomic<size_t> gAllocationCount { 0 };
+
+    void* countedAllocate(size_t size, size_t alignment) {
+        if (gCountAllocations) {
+            ++gAllocationCount;
+        }
+
+        size = (std::max<size_t>(size, 1u) + alignment - 1) / alignment * alignment;
+        if (void* memory = std::aligned_alloc(alignment, size)) {
+            return memory;
+        }
+
+        throw std::bad_alloc();
+    }
+}
+
+// Counts global allocations made while `gCountAllocations` is set.
+void* operator new(size_t size) {
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return countedAllocate(size, (size_t)alignment);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+TEST_CASE("Arena allocations", "[TaskArena]") {
+    static constexpr size_t ALLOCATION_SIZE = 1000;
+    static constexpr size_t ALLOCATION_COUNT = 3 * TaskArena::CHUNK_SIZE / ALLOCATION_SIZE;
+
+    TaskArena arena;
+    std::vector<uint8_t*> allocations;
+
+    for (auto i = 0u; i < ALLOCATION_COUNT; i++) {
+        auto* memory = (uint8_t*)arena.allocate(ALLOCATION_SIZE, alignof(std::max_align_t));
+        REQUIRE((uintptr_t)memory % alignof(std::max_align_t) == 0);
+        std::fill(memory, memory + ALLOCATION_SIZE, (uint8_t)i);
+        allocations.push_back(memory);
+    }
+
+    for (auto i = 0u; i < ALLOCATION_COUNT; i++) {
+        REQUIRE(allocations[i][0] == (uint8_t)i);
+        REQUIRE(allocations[i][ALLOCATION_SIZE - 1] == (uint8_t)i);
+    }
+
+    auto chunkCount = arena.chunkCount();
+    REQUIRE(chunkCount >= 3);
+
+    // Freed chunks are reused instead of allocating new ones.
+    for (auto round = 0u; round < 3; round++) {
+        for (auto* memory : allocations) {
+            TaskArena::free(memory);
+        }
+
+        allocations.clear();
+        for (auto i = 0u; i < ALLOCATION_COUNT; i++) {
+            allocations.push_back((uint8_t*)arena.allocate(ALLOCATION_SIZE, alignof(std::max_align_t)));
+        }
+    }
+
+    REQUIRE(arena.chunkCount() <= chunkCount + 1);
+
+    for (auto* memory : allocations) {
+        TaskArena::free(memory);
+    }
+}
+
+TEST_CASE("Arena allocations larger than a chunk", "[TaskArena]") {
+    TaskArena arena;
+
+    auto* memory = (uint8_t*)arena.allocate(3 * TaskArena::CHUNK_SIZE, alignof(std::max_align_t));
+    std::fill(memory, memory + 3 * TaskArena::CHUNK_SIZE, 0xab);
+    TaskArena::free(memory);
+
+    REQUIRE(arena.chunkCount() == 0);
+}
+
+TEST_CASE("Arena allocations freed by other threads", "[TaskArena]") {
+    static constexpr size_t ALLOCATION_SIZE = 4096;
+    static constexpr size_t ALLOCATION_COUNT = 64;
+
+    TaskArena arena;
+
+    for (auto round = 0u; round < 20; round++) {
+        std::vector<void*> allocations;
+        for (auto i = 0u; i < ALLOCATION_COUNT; i++) {
+            allocations.push_back(arena.allocate(ALLOCATION_SIZE, alignof(std::max_align_t)));
+        }
+
+        std::thread thread([&]() {
+            for (auto* memory : allocations) {
+                TaskArena::free(memory);
+            }
+        });
+
+        thread.join();
+    }
+
+    REQUIRE(arena.chunkCount() <= 6);
+}
+
+TEST_CASE("Spawning tasks doesn't allocate", "[TaskArena]") {
+    static constexpr size_t TASK_COUNT = 2000;
+
+    std::atomic<size_t> sum { 0 };
+
+    tasks::init(1);
+
+    // Small, size-classed and oversized payloads, the latter coming from the worker's arena.
+    auto spawn = [&]() {
+        auto task = tasks::add([&](auto& task) {
+            for (auto i = 0u; i < TASK_COUNT; i++) {
+                tasks::add(task, [&sum, i](auto&) {
+                    sum += i;
+                });
+
+                std::array<uint32_t, 32> medium {};
+                medium[0] = i;
+                tasks::add(task, [&sum, medium](auto&) {
+                    sum += medium[0];
+                });
+
+                std::array<uint32_t, 256> large {};
+                large[255] = i;
+                tasks::add(task, [&sum, large](auto&) {
+                    sum += large[255];
+                });
+            }
+        });
+
+        tasks::wait(task);
+    };
+
+    // Warm up pools, queues and the arena.
+    spawn();
+
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    spawn();
+    gCountAllocations = false;
+
+    tasks::shutdown();
+
+    REQUIRE(gAllocationCount == 0);
+    REQUIRE(sum == 2 * 3 * (TASK_COUNT * (TASK_COUNT - 1) / 2));
+}
+
+TEST_CASE("Futures don't allocate", "[TaskArena]") {
+    static constexpr size_t FUTURE_COUNT = 1000;
+
+    size_t sum = 0;
+
+    tasks::init(1);
+
+    auto run = [&]() {
+        for (auto i = 0u; i < FUTURE_COUNT; i++) {
+            auto future = tasks::async([i](auto&) {
+                return std::array<size_t, 4> { i, i, i, i };
+            }).then([](auto&, std::array<size_t, 4> values) {
+                return values[0] + values[3];
+            });
+
+            tasks::wait(future);
+            sum += future.get();
+        }
+    };
+
+    // Warm up pools and queues.
+    run();
+
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    run();
+    gCountAllocations = false;
+
+    tasks::shutdown();
+
+    REQUIRE(gAllocationCount == 0);
+    REQUIRE(sum == 2 * 2 * (FUTURE_COUNT * (FUTURE_COUNT - 1) / 2));
+}
+
+TEST_CASE("Running recorded graphs doesn't allocate", "[TaskArena]") {
+    static constexpr size_t LAYER_COUNT = 20;
+    static constexpr size_t LAYER_SIZE = 50;
+
+    std::atomic<size_t> sum { 0 };
+
+    tasks::init(1);
+
+    tasks::Graph graph;
+    for (auto layer = 0u; layer < LAYER_COUNT; layer++) {
+        for (auto i = 0u; i < LAYER_SIZE; i++) {
+            auto node = graph.add([&sum, i](auto&) {
+                sum += i;
+            });
+
+            if (layer > 0) {
+                graph.precede(node - LAYER_SIZE, node);
+                graph.precede(node - LAYER_SIZE + (i + 1) % LAYER_SIZE - i, node);
+            }
+        }
+    }
+
+    // The first run compiles the graph and warms up pools.
+    auto task = graph.run();
+    tasks::wait(task);
+
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    task = graph.run();
+    tasks::wait(task);
+    gCountAllocations = false;
+
+    tasks::shutdown();
+
+    REQUIRE(gAllocationCount == 0);
+    REQUIRE(sum == 2 * LAYER_COUNT * (LAYER_SIZE * (LAYER_SIZE - 1) / 2));
+}
+
+#ifdef TASKGRAPH_HAS_COROUTINES
+namespace {
+    tasks::co_task<size_t> addPair(size_t i) {
+        co_await tasks::add([](auto&) { });
+        co_return i + i;
+    }
+
+    tasks::co_task<size_t> addPairs(size_t i) {
+        auto first = co_await addPair(i);
+        co_return first + co_await addPair(i);
+    }
+}
+
+TEST_CASE("Coroutine frames don't allocate", "[TaskArena]") {
+    static constexpr size_t COROUTINE_COUNT = 1000;
+
+    size_t sum = 0;
+
+    tasks::init(1);
+
+    auto run = [&]() {
+        for (auto i = 0u; i < COROUTINE_COUNT; i++) {
+            auto future = tasks::async(addPairs(i));
+            tasks::wait(future);
+            sum += future.get();
+        }
+    };
+
+    // Warm up pools and queues.
+    run();
+
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    run();
+    gCountAllocations = false;
+
+    tasks::shutdown();
+
+    REQUIRE(gAllocationCount == 0);
+    REQUIRE(sum == 2 * 4 * (COROUTINE_COUNT * (COROUTINE_COUNT - 1) / 2));
+}
+#endif
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <thread>
 #include <catch2/catch.hpp>
 #include <taskgraph/TaskGraph.h>
 
@@ -29,3 +31,211 @@ TEST_CASE("Deque functionality", "[TaskQueue]") {
     REQUIRE(queue.size() == 1);
     REQUIRE(queue.steal() == &tasks[0]);
 }
+
+TEST_CASE("Deque growth", "[TaskQueue]") {
+    static constexpr size_t TASK_COUNT = 10000;
+
+    TaskQueue queue;
+    std::vector<Task> tasks { TASK_COUNT };
+
+    auto initialCapacity = queue.capacity();
+
+    for (auto& task : tasks) {
+        queue.push(&task);
+    }
+
+    REQUIRE(queue.size() == TASK_COUNT);
+    REQUIRE(queue.capacity() > initialCapacity);
+    REQUIRE(queue.capacity() >= TASK_COUNT);
+
+    REQUIRE(queue.steal() == &tasks[0]);
+    REQUIRE(queue.steal() == &tasks[1]);
+
+    for (auto i = TASK_COUNT - 1; i >= 2; i--) {
+        REQUIRE(queue.pop() == &tasks[i]);
+    }
+
+    REQUIRE(queue.size() == 0);
+    REQUIRE(queue.pop() == nullptr);
+}
+
+TEST_CASE("Deque growth while stealing", "[TaskQueue]") {
+    static constexpr size_t TASK_COUNT = 50000;
+
+    TaskQueue queue;
+    std::vector<Task> tasks { TASK_COUNT };
+    std::vector<std::atomic<int>> hits(TASK_COUNT);
+    std::atomic<bool> done { false };
+
+    auto record = [&](Task* task) {
+        hits[task - tasks.data()]++;
+    };
+
+    std::thread thief([&]() {
+        while (!done || queue.size() > 0) {
+            if (auto* task = queue.steal()) {
+                record(task);
+            }
+        }
+    });
+
+    for (auto i = 0u; i < TASK_COUNT; i++) {
+        queue.push(&tasks[i]);
+
+        if (i % 3 == 0) {
+            if (auto* task = queue.pop()) {
+                record(task);
+            }
+        }
+    }
+
+    while (auto* task = queue.pop()) {
+        record(task);
+    }
+
+    done = true;
+    thief.join();
+
+    auto executedOnce = std::count_if(hits.begin(), hits.end(), [](auto& hit) { return hit == 1; });
+    REQUIRE(executedOnce == TASK_COUNT);
+}
+
+TEST_CASE("Concurrent stress", "[TaskQueue]") {
+    static constexpr size_t TASK_COUNT = 200000;
+    static constexpr size_t THIEF_COUNT = 3;
+
+    TaskQueue queue;
+    std::vector<Task> tasks { TASK_COUNT };
+    std::vector<std::atomic<int>> hits(TASK_COUNT);
+    std::atomic<bool> done { false };
+    std::vector<std::thread> thieves;
+
+    auto record = [&](Task* task) {
+        hits[task - tasks.data()].fetch_add(1, std::memory_order_relaxed);
+    };
+
+    for (auto i = 0u; i < THIEF_COUNT; i++) {
+        thieves.emplace_back([&]() {
+            while (!done.load(std::memory_order_acquire)) {
+                if (auto* task = queue.steal()) {
+                    record(task);
+                }
+            }
+        });
+    }
+
+    // Pseudo-random mix of pushes and pops with the queue frequently drained to a single item, so that the
+    // owner and thieves race for the last task.
+    uint32_t rng = 0x9e3779b9u;
+    for (auto i = 0u; i < TASK_COUNT; i++) {
+        queue.push(&tasks[i]);
+
+        rng ^= rng << 13u;
+        rng ^= rng >> 17u;
+        rng ^= rng << 5u;
+
+        for (auto pops = rng % 4u; pops > 0; pops--) {
+            if (auto* task = queue.pop()) {
+                record(task);
+            }
+        }
+    }
+
+    while (auto* task = queue.pop()) {
+        record(task);
+    }
+
+    done.store(true, std::memory_order_release);
+    for (auto& thief : thieves) {
+        thief.join();
+    }
+
+    auto executedOnce = std::count_if(hits.begin(), hits.end(), [](auto& hit) { return hit == 1; });
+    REQUIRE(executedOnce == TASK_COUNT);
+}
+
+TEST_CASE("Batch stealing", "[TaskQueue]") {
+    TaskQueue queue;
+    TaskQueue destination;
+    std::vector<Task> tasks { 10 };
+
+    REQUIRE(queue.stealBatch(destination) == nullptr);
+
+    for (auto& task : tasks) {
+        queue.push(&task);
+    }
+
+    // Half of the queue is stolen: one task is returned, the rest are moved in order.
+    REQUIRE(queue.stealBatch(destination) == &tasks[0]);
+    REQUIRE(queue.size() == 5);
+    REQUIRE(destination.size() == 4);
+
+    REQUIRE(destination.steal() == &tasks[1]);
+    REQUIRE(destination.pop() == &tasks[4]);
+    REQUIRE(queue.steal() == &tasks[5]);
+    REQUIRE(queue.pop() == &tasks[9]);
+
+    while (queue.pop() != nullptr) { }
+
+    queue.push(&tasks[0]);
+    REQUIRE(queue.stealBatch(destination) == &tasks[0]);
+    REQUIRE(queue.size() == 0);
+}
+
+TEST_CASE("Concurrent batch stealing stress", "[TaskQueue]") {
+    static constexpr size_t TASK_COUNT = 200000;
+    static constexpr size_t THIEF_COUNT = 3;
+
+    TaskQueue queue;
+    std::vector<Task> tasks { TASK_COUNT };
+    std::vector<std::atomic<int>> hits(TASK_COUNT);
+    std::atomic<bool> done { false };
+    std::vector<std::thread> thieves;
+
+    auto record = [&](Task* task) {
+        hits[task - tasks.data()].fetch_add(1, std::memory_order_relaxed);
+    };
+
+    for (auto i = 0u; i < THIEF_COUNT; i++) {
+        thieves.emplace_back([&]() {
+            TaskQueue local;
+
+            while (!done.load(std::memory_order_acquire)) {
+                if (auto* task = queue.stealBatch(local)) {
+                    record(task);
+                }
+
+                while (auto* task = local.pop()) {
+                    record(task);
+                }
+            }
+        });
+    }
+
+    uint32_t rng = 0x9e3779b9u;
+    for (auto i = 0u; i < TASK_COUNT; i++) {
+        queue.push(&tasks[i]);
+
+        rng ^= rng << 13u;
+        rng ^= rng >> 17u;
+        rng ^= rng << 5u;
+
+        for (auto pops = rng % 4u; pops > 0; pops--) {
+            if (auto* task = queue.pop()) {
+                record(task);
+            }
+        }
+    }
+
+    while (auto* task = queue.pop()) {
+        record(task);
+    }
+
+    done.store(true, std::memory_order_release);
+    for (auto& thief : thieves) {
+        thief.join();
+    }
+
+    auto executedOnce = std::count_if(hits.begin(), hits.end(), [](auto& hit) { return hit == 1; });
+    REQUIRE(executedOnce == TASK_COUNT);
+}
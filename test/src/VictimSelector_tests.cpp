@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <taskgraph/Topology.h>
+#include <taskgraph/VictimSelector.h>
+
+namespace {
+    // Two packages with a shared L3 each and pairs of CPUs sharing L2.
+    Topology makeTopology() {
+        std::vector<Topology::Cpu> cpus;
+        for (auto id = 0; id < 8; id++) {
+            cpus.push_back({ (uint32_t)id, id / 2 * 2, id / 4 * 4, id / 4 });
+        }
+
+        return Topology(cpus);
+    }
+
+    std::vector<size_t> scan(VictimSelector& selector) {
+        std::vector<size_t> victims;
+
+        selector.beginScan();
+        for (auto i = 0u; i < selector.victimCount(); i++) {
+            victims.push_back(selector.victim(i));
+        }
+
+        return victims;
+    }
+}
+
+TEST_CASE("Topology distance", "[VictimSelector]") {
+    auto topology = makeTopology();
+
+    REQUIRE(topology.distance(0, 0) == Topology::SHARED_L2_DISTANCE);
+    REQUIRE(topology.distance(0, 1) == Topology::SHARED_L2_DISTANCE);
+    REQUIRE(topology.distance(0, 2) == Topology::SHARED_L3_DISTANCE);
+    REQUIRE(topology.distance(0, 4) == Topology::REMOTE_DISTANCE);
+
+    // Workers wrap around CPUs.
+    REQUIRE(topology.distance(0, 8) == Topology::SHARED_L2_DISTANCE);
+
+    REQUIRE(Topology::read().getCpuCount() > 0);
+}
+
+TEST_CASE("Every scan probes every other worker once", "[VictimSelector]") {
+    static constexpr size_t WORKER_COUNT = 8;
+
+    auto topology = makeTopology();
+    auto policy = GENERATE(VictimPolicy::Linear, VictimPolicy::Random, VictimPolicy::Hierarchical);
+
+    for (auto index = 0u; index < WORKER_COUNT; index++) {
+        VictimSelector selector(policy, index, WORKER_COUNT, &topology);
+        REQUIRE(selector.victimCount() == WORKER_COUNT - 1);
+
+        for (auto i = 0u; i < 10; i++) {
+            auto victims = scan(selector);
+            selector.onSteal(i % victims.size());
+
+            std::sort(victims.begin(), victims.end());
+            REQUIRE(std::unique(victims.begin(), victims.end()) == victims.end());
+            REQUIRE(std::find(victims.begin(), victims.end(), index) == victims.end());
+            REQUIRE(victims.size() == WORKER_COUNT - 1);
+        }
+    }
+}
+
+TEST_CASE("Linear scans start from the last victim", "[VictimSelector]") {
+    VictimSelector selector(VictimPolicy::Linear, 0, 4, nullptr);
+
+    REQUIRE(scan(selector) == std::vector<size_t> { 1, 2, 3 });
+
+    selector.onSteal(1);
+    REQUIRE(scan(selector) == std::vector<size_t> { 2, 3, 1 });
+}
+
+TEST_CASE("Hierarchical scans probe closest workers first", "[VictimSelector]") {
+    auto topology = makeTopology();
+    VictimSelector selector(VictimPolicy::Hierarchical, 0, 8, &topology);
+
+    for (auto i = 0u; i < 10; i++) {
+        auto victims = scan(selector);
+
+        REQUIRE(victims[0] == 1);
+        REQUIRE(std::is_permutation(victims.begin() + 1, victims.begin() + 3, std::vector<size_t> { 2, 3 }.begin()));
+        REQUIRE(std::is_permutation(victims.begin() + 3, victims.end(), std::vector<size_t> { 4, 5, 6, 7 }.begin()));
+    }
+}
@@ -51,7 +51,7 @@ TEST_CASE("Task graph", "[tasks]") {
             tasks::wait(task);
 
             for (auto& worker : tasks::getGraph()->workers) {
-                REQUIRE(worker.getTaskPool()->size() == Worker::TASK_POOL_SIZE);
+                REQUIRE(worker.getTaskPool()->size() == Worker::TASK_POOL_SLAB_SIZE);
             }
 
             tasks::shutdown();
@@ -114,4 +114,1503 @@ TEST_CASE("Data cleanup", "[tasks]") {
     }
 
     REQUIRE(!bTestAlive);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Submission from non-worker threads", "[tasks]") {
+    static constexpr size_t THREAD_COUNT = 4;
+    static constexpr size_t TASKS_PER_THREAD = 1000;
+
+    std::atomic<int> x { 0 };
+    std::atomic<int> y { 0 };
+
+    std::atomic<int> nonWorkers { 0 };
+
+    // Non-worker threads only get help from background workers, make sure there are some.
+    tasks::init(4);
+
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < THREAD_COUNT; i++) {
+        threads.emplace_back([&]() {
+            if (TaskGraph::getThreadWorker() == nullptr) {
+                ++nonWorkers;
+            }
+
+            for (auto j = 0u; j < TASKS_PER_THREAD; j++) {
+                auto task = tasks::add([&](auto& task) {
+                    ++x;
+
+                    tasks::add(task, [&](auto&) {
+                        ++y;
+                    });
+                });
+
+                if (j % 100 == 0) {
+                    tasks::wait(task);
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    REQUIRE(nonWorkers == THREAD_COUNT);
+
+    while (x != THREAD_COUNT * TASKS_PER_THREAD || y != THREAD_COUNT * TASKS_PER_THREAD) {
+        std::this_thread::yield();
+    }
+
+    tasks::shutdown();
+
+    REQUIRE(x == THREAD_COUNT * TASKS_PER_THREAD);
+    REQUIRE(y == THREAD_COUNT * TASKS_PER_THREAD);
+}
+
+TEST_CASE("Priorities", "[tasks]") {
+    static constexpr size_t TASK_COUNT = 5;
+
+    std::vector<tasks::Priority> order;
+
+    // With a single worker tasks only execute while the foreground thread waits.
+    tasks::init(1);
+
+    auto first = tasks::add(tasks::Priority::Low, [&](auto&) {
+        order.push_back(tasks::Priority::Low);
+    });
+
+    for (auto i = 1u; i < TASK_COUNT; i++) {
+        tasks::add(tasks::Priority::Low, [&](auto&) {
+            order.push_back(tasks::Priority::Low);
+        });
+    }
+
+    for (auto i = 0u; i < TASK_COUNT; i++) {
+        tasks::add(tasks::Priority::High, [&](auto& task) {
+            REQUIRE(task.getPriority() == tasks::Priority::High);
+
+            // Subtasks inherit priority.
+            tasks::add(task, [&](auto& subtask) {
+                REQUIRE(subtask.getPriority() == tasks::Priority::High);
+            });
+
+            order.push_back(tasks::Priority::High);
+        });
+    }
+
+    tasks::wait(first);
+    tasks::shutdown();
+
+    REQUIRE(order.size() == TASK_COUNT * 2);
+    for (auto i = 0u; i < TASK_COUNT; i++) {
+        REQUIRE(order[i] == tasks::Priority::High);
+        REQUIRE(order[i + TASK_COUNT] == tasks::Priority::Low);
+    }
+}
+
+TEST_CASE("Priority starvation", "[tasks]") {
+    static constexpr size_t TASK_COUNT = 100;
+
+    size_t executed = 0;
+    size_t lowExecutedAt = 0;
+
+    tasks::init(1);
+
+    auto low = tasks::add(tasks::Priority::Low, [&](auto&) {
+        lowExecutedAt = ++executed;
+    });
+
+    for (auto i = 0u; i < TASK_COUNT; i++) {
+        tasks::add(tasks::Priority::High, [&](auto&) {
+            ++executed;
+        });
+    }
+
+    tasks::wait(low);
+    tasks::shutdown();
+
+    REQUIRE(lowExecutedAt > 0);
+    REQUIRE(lowExecutedAt <= Worker::PRIORITY_STARVATION_LIMIT);
+}
+
+TEST_CASE("Victim policies", "[tasks]") {
+    static constexpr size_t TASK_COUNT = 1000;
+
+    std::atomic<size_t> executed { 0 };
+
+    tasks::Options options;
+    options.numThreads = 4;
+    options.victimPolicy = GENERATE(VictimPolicy::Linear, VictimPolicy::Random, VictimPolicy::Hierarchical);
+
+    tasks::init(options);
+
+    auto task = tasks::add([&](auto& task) {
+        for (auto i = 0u; i < TASK_COUNT; i++) {
+            tasks::add(task, [&](auto&) {
+                ++executed;
+            });
+        }
+    });
+
+    tasks::wait(task);
+    tasks::shutdown();
+
+    REQUIRE(executed == TASK_COUNT);
+}
+
+TEST_CASE("Parked workers wake up on submit", "[tasks]") {
+    static constexpr size_t TASK_COUNT = 100;
+
+    std::atomic<size_t> executed { 0 };
+    std::atomic<bool> ranOnBackground { false };
+
+    tasks::init(4);
+
+    for (auto round = 0u; round < 3; round++) {
+        // Give workers time to run out of spinning and park.
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        // Not waiting on the foreground thread, so background workers have to wake up to run the tasks.
+        for (auto i = 0u; i < TASK_COUNT; i++) {
+            tasks::add([&](auto&) {
+                if (TaskGraph::getThreadWorker() != &tasks::getGraph()->workers[0]) {
+                    ranOnBackground = true;
+                }
+
+                ++executed;
+            });
+        }
+
+        while (executed != (round + 1) * TASK_COUNT) {
+            std::this_thread::yield();
+        }
+    }
+
+    tasks::shutdown();
+
+    REQUIRE(executed == 3 * TASK_COUNT);
+    REQUIRE(ranOnBackground);
+}
+
+TEST_CASE("Bounded searching workers", "[tasks]") {
+    static constexpr size_t TASK_COUNT = 1000;
+
+    std::atomic<size_t> executed { 0 };
+
+    tasks::Options options;
+    options.numThreads = 4;
+    options.maxSearchingWorkers = GENERATE(1u, 4u);
+
+    tasks::init(options);
+
+    for (auto round = 0u; round < 3; round++) {
+        // Let workers go idle, so the fan-out has to wake them up again one searcher at a time.
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        auto task = tasks::add([&](auto& task) {
+            for (auto i = 0u; i < TASK_COUNT; i++) {
+                tasks::add(task, [&](auto&) {
+                    ++executed;
+                });
+            }
+        });
+
+        tasks::wait(task);
+    }
+
+    tasks::shutdown();
+
+    REQUIRE(executed == 3 * TASK_COUNT);
+}
+
+TEST_CASE("Task pool growth", "[tasks]") {
+    static constexpr size_t TASK_COUNT = 3 * Worker::TASK_POOL_SLAB_SIZE;
+
+    std::atomic<size_t> executed { 0 };
+    size_t growthCount = 0;
+
+    tasks::init(1);
+
+    // All subtasks are in flight at once, more than fit into a single slab.
+    auto task = tasks::add([&](auto& task) {
+        for (auto i = 0u; i < TASK_COUNT; i++) {
+            tasks::add(task, [&](auto&) {
+                ++executed;
+            });
+        }
+
+        growthCount = Worker::getTaskPool()->growthCount();
+    });
+
+    tasks::wait(task);
+    tasks::shutdown();
+
+    REQUIRE(executed == TASK_COUNT);
+    REQUIRE(growthCount >= 2);
+}
+
+TEST_CASE("Task size classes", "[tasks]") {
+    std::atomic<size_t> sum { 0 };
+
+    tasks::init(1);
+
+    // Captures of every size class are stored inline and allocated from the pool of their class.
+    auto testClass = [&](auto capture, auto* pool) {
+        using Capture = decltype(capture);
+
+        for (auto i = 0u; i < std::tuple_size_v<Capture>; i++) {
+            capture[i] = i;
+        }
+
+        auto freeBefore = pool->size();
+        auto task = tasks::add([&sum, capture](auto&) {
+            for (auto value : capture) {
+                sum += value;
+            }
+        });
+
+        REQUIRE(pool->size() == freeBefore - 1);
+        tasks::wait(task);
+        REQUIRE(pool->size() == freeBefore);
+    };
+
+    testClass(std::array<uint8_t, 8> {}, Worker::getTaskPool<Task>());
+    testClass(std::array<uint8_t, 24> {}, Worker::getTaskPool<Task>());
+    testClass(std::array<uint8_t, 64> {}, Worker::getTaskPool<SizedTask<2>>());
+    testClass(std::array<uint8_t, 128> {}, Worker::getTaskPool<SizedTask<3>>());
+    testClass(std::array<uint8_t, 256> {}, Worker::getTaskPool<SizedTask<MAX_TASK_LINE_COUNT>>());
+
+    tasks::shutdown();
+
+    REQUIRE(sum == 7 * 8 / 2 + 23 * 24 / 2 + 63 * 64 / 2 + 127 * 128 / 2 + 255 * 256 / 2);
+}
+
+TEST_CASE("Task ops", "[tasks]") {
+    auto trivial = [value = 1](auto&) { return value; };
+    auto shared = [value = std::make_shared<int>(1)](auto&) { return *value; };
+    auto large = [value = std::array<uint8_t, 1024> {}](auto&) { return value[0]; };
+
+    // Only payloads with a destructor or stored out of line need to be torn down.
+    REQUIRE(TASK_OPS<decltype(trivial)>.destroy == nullptr);
+    REQUIRE(TASK_OPS<decltype(shared)>.destroy != nullptr);
+    REQUIRE(TASK_OPS<decltype(large)>.destroy != nullptr);
+
+    // Tasks with the same payload type share their ops.
+    REQUIRE(&TASK_OPS<decltype(trivial)> == &TASK_OPS<decltype(trivial)>);
+    REQUIRE(&TASK_OPS<decltype(trivial)> != (const void*)&TASK_OPS<decltype(shared)>);
+
+    std::atomic<int> sum { 0 };
+    tasks::init(1);
+
+    auto capture = std::make_shared<int>(2);
+    auto task = tasks::add([&sum, capture](auto&) {
+        sum += *capture;
+    });
+
+    tasks::wait(task);
+    tasks::shutdown();
+
+    REQUIRE(sum == 2);
+    REQUIRE(capture.use_count() == 1);
+}
+
+TEST_CASE("Move-only and mutable task callables", "[tasks]") {
+    std::atomic<int> sum { 0 };
+
+    tasks::init(1);
+
+    auto value = std::make_unique<int>(1);
+    auto task = tasks::add([&sum, value = std::move(value)](auto&) {
+        sum += *value;
+    });
+
+    tasks::wait(task);
+
+    auto chain = tasks::chain()
+        ->add([&sum, value = std::make_unique<int>(2)](auto&) {
+            sum += *value;
+        })
+        ->add([&sum, count = 0](auto&) mutable {
+            sum += ++count * 4;
+        })
+        ->submit();
+
+    tasks::wait(chain);
+
+    // Out of line payloads are handed over as well.
+    task = tasks::add([&sum, buffer = std::vector<int>(1000, 1), padding = std::array<uint8_t, 1024> {}](auto&) {
+        for (auto& element : buffer) {
+            sum += element;
+        }
+    });
+
+    tasks::wait(task);
+    tasks::shutdown();
+
+    REQUIRE(sum == 1 + 2 + 4 + 1000);
+}
+
+TEST_CASE("Task callables are copied at most once", "[tasks]") {
+    struct CopyCounter {
+        size_t* copies;
+        size_t* moves;
+
+        CopyCounter(size_t* inCopies, size_t* inMoves)
+            :copies { inCopies }, moves { inMoves } {
+        }
+
+        CopyCounter(const CopyCounter& other)
+            :copies { other.copies }, moves { other.moves } {
+            ++*copies;
+        }
+
+        CopyCounter(CopyCounter&& other) noexcept
+            :copies { other.copies }, moves { other.moves } {
+            ++*moves;
+        }
+    };
+
+    size_t copies = 0;
+    size_t moves = 0;
+
+    tasks::init(1);
+
+    auto taskFn = [counter = CopyCounter(&copies, &moves)](auto&) { };
+    copies = moves = 0;
+
+    auto task = tasks::add(taskFn);
+    tasks::wait(task);
+    REQUIRE(copies == 1);
+    REQUIRE(moves == 0);
+
+    copies = moves = 0;
+    task = tasks::add(std::move(taskFn));
+    tasks::wait(task);
+    REQUIRE(copies == 0);
+    REQUIRE(moves == 1);
+
+    copies = moves = 0;
+    task = tasks::chain()->add(taskFn)->add(std::move(taskFn))->submit();
+    tasks::wait(task);
+    REQUIRE(copies == 1);
+    REQUIRE(moves == 1);
+
+    tasks::shutdown();
+}
+
+TEST_CASE("Task futures", "[tasks]") {
+    tasks::init();
+
+    SECTION("Results") {
+        auto number = tasks::async([](auto&) {
+            return 42;
+        });
+
+        auto text = tasks::async([](auto&) {
+            return std::string(100, 'x');
+        });
+
+        tasks::wait(number);
+        tasks::wait(text);
+        REQUIRE(number.ready());
+        REQUIRE(number.get() == 42);
+        REQUIRE(text.get() == std::string(100, 'x'));
+    }
+
+    SECTION("Results are complete once subtasks finish") {
+        std::atomic<int> count { 0 };
+        auto future = tasks::async([&count](auto& task) {
+            for (auto i = 0u; i < 100u; i++) {
+                tasks::add(task, [&count](auto&) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    ++count;
+                });
+            }
+
+            return 1;
+        }).then([&count](auto&, int value) {
+            return value + count;
+        });
+
+        tasks::wait(future);
+        REQUIRE(future.get() == 101);
+    }
+
+    SECTION("Continuations") {
+        auto future = tasks::async([](auto&) {
+            return std::make_unique<int>(2);
+        }).then([](auto&, std::unique_ptr<int> value) {
+            return *value * 3;
+        }).then([](auto&, int value) {
+            return std::to_string(value);
+        });
+
+        tasks::wait(future);
+        REQUIRE(future.get() == "6");
+    }
+
+    SECTION("Continuations of finished tasks") {
+        auto future = tasks::async([](auto&) {
+            return 5;
+        });
+
+        tasks::wait(future);
+
+        auto next = future.then([](auto&, int value) {
+            return value + 1;
+        });
+
+        REQUIRE(!future.valid());
+        tasks::wait(next);
+        REQUIRE(next.get() == 6);
+    }
+
+    SECTION("Void results") {
+        std::atomic<int> count { 0 };
+        auto future = tasks::async([&count](auto&) {
+            ++count;
+        }).then([&count](auto&) {
+            return count * 2;
+        });
+
+        tasks::wait(future);
+        REQUIRE(future.get() == 2);
+    }
+
+    SECTION("Results are destroyed with their future") {
+        auto value = std::make_shared<int>(1);
+        {
+            auto future = tasks::async([value](auto&) {
+                return value;
+            });
+
+            tasks::wait(future);
+            REQUIRE(value.use_count() == 2);
+        }
+
+        REQUIRE(value.use_count() == 1);
+    }
+
+    tasks::shutdown();
+}
+
+TEST_CASE("Task dependencies", "[tasks]") {
+    tasks::init(std::max(4u, std::thread::hardware_concurrency()));
+
+    SECTION("Predecessors which aren't submitted yet") {
+        std::atomic<int> finished { 0 };
+        std::atomic<int> seen { -1 };
+
+        auto a = tasks::create([&finished](auto&) { ++finished; });
+        auto b = tasks::create([&finished](auto&) { ++finished; });
+        auto c = tasks::create([&finished](auto&) { ++finished; });
+
+        auto task = tasks::after({ a, b, c }, [&](auto&) {
+            seen = finished.load();
+        });
+
+        REQUIRE(task.valid());
+        a->submit();
+        b->submit();
+        c->submit();
+
+        tasks::wait(task);
+        REQUIRE(seen == 3);
+    }
+
+    SECTION("Running and finished predecessors") {
+        std::atomic<bool> release { false };
+        std::atomic<int> seen { -1 };
+
+        auto finished = tasks::add([](auto&) { });
+        tasks::wait(finished);
+
+        auto running = tasks::add([&release](auto&) {
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+
+        auto task = tasks::after({ finished, running }, [&](auto&) {
+            seen = release ? 1 : 0;
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        REQUIRE(seen == -1);
+        release = true;
+
+        tasks::wait(task);
+        REQUIRE(seen == 1);
+    }
+
+    SECTION("Predecessors finishing while edges are added") {
+        static constexpr size_t THREAD_COUNT = 2;
+        static constexpr size_t EDGE_COUNT = 20000;
+
+        // Predecessors are submitted through the injection queue, so that workers race to finish them while
+        // successors are linked, and their slots are reused right away.
+        std::atomic<size_t> count { 0 };
+        std::vector<std::thread> threads;
+        for (auto i = 0u; i < THREAD_COUNT; i++) {
+            threads.emplace_back([&count]() {
+                std::vector<tasks::TaskHandle> successors;
+                for (auto j = 0u; j < EDGE_COUNT; j++) {
+                    auto predecessor = tasks::add([](auto&) { });
+                    successors.push_back(tasks::after({ predecessor }, [&count](auto&) {
+                        ++count;
+                    }));
+                }
+
+                for (auto& successor : successors) {
+                    tasks::wait(successor);
+                }
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        REQUIRE(count == THREAD_COUNT * EDGE_COUNT);
+    }
+
+    SECTION("Explicit edges") {
+        std::vector<int> order;
+        std::mutex mutex;
+        auto record = [&](int value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(value);
+        };
+
+        // Diamond: a -> (b, c) -> d.
+        auto a = tasks::create([&](auto&) { record(0); });
+        auto b = tasks::create([&](auto&) { record(1); });
+        auto c = tasks::create([&](auto&) { record(1); });
+        auto d = tasks::create([&](auto&) { record(2); });
+
+        a->precede(*b);
+        a->precede(*c);
+        b->precede(*d);
+        c->precede(*d);
+
+        d->submit();
+        c->submit();
+        b->submit();
+        a->submit();
+
+        tasks::wait(d);
+        REQUIRE(order == std::vector<int> { 0, 1, 1, 2 });
+    }
+
+    SECTION("Too many predecessors") {
+        std::atomic<bool> ran { false };
+        auto predecessor = tasks::create([](auto&) { });
+        auto successor = tasks::create([&ran](auto&) { ran = true; });
+
+        for (auto i = 0u; i < Task::MAX_PREDECESSOR_COUNT; i++) {
+            predecessor->precede(*successor);
+        }
+
+        REQUIRE_THROWS_AS(predecessor->precede(*successor), std::length_error);
+
+        successor->submit();
+        predecessor->submit();
+        tasks::wait(successor);
+        REQUIRE(ran);
+    }
+
+    SECTION("Too many predecessors at once") {
+        std::atomic<bool> ran { false };
+        auto predecessor = tasks::create([](auto&) { });
+        auto first = tasks::create([](auto&) { });
+        auto second = tasks::create([](auto&) { });
+        auto successor = tasks::create([&ran](auto&) { ran = true; });
+
+        // Leave room for a single predecessor.
+        for (auto i = 1u; i < Task::MAX_PREDECESSOR_COUNT; i++) {
+            predecessor->precede(*successor);
+        }
+
+        REQUIRE_THROWS_AS(Task::precede({ first, second }, *successor), std::length_error);
+
+        // Neither edge was added, so there's still room for one of them.
+        Task::precede(second, *successor);
+        REQUIRE_THROWS_AS(Task::precede(first, *successor), std::length_error);
+
+        first->submit();
+        tasks::wait(first);
+        REQUIRE(!ran);
+
+        successor->submit();
+        predecessor->submit();
+        second->submit();
+        tasks::wait(successor);
+        REQUIRE(ran);
+    }
+
+    SECTION("Random graphs") {
+        static constexpr size_t NODE_COUNT = 2000;
+        static constexpr size_t MAX_PREDECESSORS = 4;
+
+        std::vector<std::atomic<bool>> done(NODE_COUNT);
+        std::atomic<size_t> violations { 0 };
+        std::vector<tasks::TaskHandle> nodes;
+        std::vector<std::vector<size_t>> predecessors(NODE_COUNT);
+
+        uint64_t seed = 42;
+        auto random = [&seed]() {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            return (size_t)(seed >> 33);
+        };
+
+        for (auto i = 0u; i < NODE_COUNT; i++) {
+            for (auto j = 0u; i > 0 && j < random() % (MAX_PREDECESSORS + 1); j++) {
+                predecessors[i].push_back(random() % i);
+            }
+
+            nodes.push_back(tasks::create([&, i](auto&) {
+                for (auto predecessor : predecessors[i]) {
+                    if (!done[predecessor]) {
+                        ++violations;
+                    }
+                }
+
+                done[i] = true;
+            }));
+
+            for (auto predecessor : predecessors[i]) {
+                nodes[predecessor]->precede(*nodes[i]);
+            }
+        }
+
+        // Submit in reverse, so that most successors are released by their predecessors.
+        std::vector<tasks::TaskHandle> handles;
+        for (auto i = NODE_COUNT; i-- > 0;) {
+            handles.push_back(nodes[i]->submit());
+        }
+
+        for (auto& handle : handles) {
+            tasks::wait(handle);
+        }
+
+        REQUIRE(violations == 0);
+        REQUIRE(std::all_of(done.begin(), done.end(), [](auto& value) { return value.load(); }));
+    }
+
+    tasks::shutdown();
+}
+
+TEST_CASE("Recorded graphs", "[tasks]") {
+    static constexpr size_t RUN_COUNT = 10;
+
+    tasks::init(std::max(4u, std::thread::hardware_concurrency()));
+
+    SECTION("Dependencies") {
+        std::vector<int> order;
+        std::mutex mutex;
+        auto record = [&](int value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(value);
+        };
+
+        // Diamond: a -> (b, c) -> d, recorded out of order.
+        tasks::Graph graph;
+        auto d = graph.add([&](auto&) { record(2); });
+        auto b = graph.add([&](auto&) { record(1); });
+        auto c = graph.add([&](auto&) { record(1); });
+        auto a = graph.add([&](auto&) { record(0); });
+        graph.precede(a, b);
+        graph.precede(a, c);
+        graph.precede(b, d);
+        graph.precede(c, d);
+
+        for (auto run = 0u; run < RUN_COUNT; run++) {
+            order.clear();
+            auto task = graph.run();
+            tasks::wait(task);
+            REQUIRE(order == std::vector<int> { 0, 1, 1, 2 });
+        }
+    }
+
+    SECTION("Successors wait for subtasks") {
+        std::atomic<int> count { 0 };
+        std::atomic<int> seen { -1 };
+
+        tasks::Graph graph;
+        auto a = graph.add([&count](auto& task) {
+            for (auto i = 0u; i < 100u; i++) {
+                tasks::add(task, [&count](auto&) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    ++count;
+                });
+            }
+        });
+
+        graph.after({ a }, [&](auto&) {
+            seen = count.load();
+        });
+
+        for (auto run = 0u; run < RUN_COUNT; run++) {
+            auto task = graph.run();
+            tasks::wait(task);
+            REQUIRE(seen == 100 * (int)(run + 1));
+        }
+    }
+
+    SECTION("Cycles") {
+        std::atomic<int> count { 0 };
+
+        tasks::Graph graph;
+        auto a = graph.add([&count](auto&) { ++count; });
+        auto b = graph.after({ a }, [&count](auto&) { ++count; });
+        auto c = graph.after({ b }, [&count](auto&) { ++count; });
+        graph.precede(c, b);
+
+        REQUIRE_THROWS_AS(graph.run(), std::logic_error);
+        REQUIRE(count == 0);
+    }
+
+    SECTION("Random graphs") {
+        static constexpr size_t NODE_COUNT = 2000;
+        static constexpr size_t MAX_PREDECESSORS = 4;
+
+        std::vector<std::atomic<uint32_t>> runs(NODE_COUNT);
+        std::atomic<size_t> violations { 0 };
+        std::vector<std::vector<size_t>> predecessors(NODE_COUNT);
+
+        uint64_t seed = 7;
+        auto random = [&seed]() {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            return (size_t)(seed >> 33);
+        };
+
+        tasks::Graph graph;
+        for (auto i = 0u; i < NODE_COUNT; i++) {
+            for (auto j = 0u; i > 0 && j < random() % (MAX_PREDECESSORS + 1); j++) {
+                predecessors[i].push_back(random() % i);
+            }
+
+            auto node = graph.add([&, i](auto&) {
+                auto run = runs[i].load();
+                for (auto predecessor : predecessors[i]) {
+                    if (runs[predecessor] != run + 1) {
+                        ++violations;
+                    }
+                }
+
+                ++runs[i];
+            });
+
+            for (auto predecessor : predecessors[i]) {
+                graph.precede((tasks::Graph::Node)predecessor, node);
+            }
+        }
+
+        REQUIRE(graph.size() == NODE_COUNT);
+
+        for (auto run = 0u; run < RUN_COUNT; run++) {
+            auto task = graph.run();
+            tasks::wait(task);
+        }
+
+        REQUIRE(violations == 0);
+        REQUIRE(std::all_of(runs.begin(), runs.end(), [](auto& value) { return value == RUN_COUNT; }));
+    }
+
+    SECTION("Large callables") {
+        std::atomic<size_t> sum { 0 };
+
+        tasks::Graph graph;
+        for (auto i = 0u; i < 10u; i++) {
+            std::array<uint8_t, 3000> data {};
+            data[2999] = (uint8_t)i;
+            graph.add([&sum, data](auto&) {
+                sum += data[2999];
+            });
+        }
+
+        auto task = graph.run();
+        tasks::wait(task);
+        REQUIRE(sum == 45);
+    }
+
+    tasks::shutdown();
+}
+
+TEST_CASE("Parallel for", "[tasks]") {
+    tasks::init(std::max(4u, std::thread::hardware_concurrency()));
+
+    auto test = [](size_t count, size_t grainSize) {
+        std::vector<std::atomic<uint32_t>> visits(count);
+
+        auto task = tasks::parallel_for(0u, count, [&visits](size_t i) {
+            ++visits[i];
+        }, grainSize);
+
+        tasks::wait(task);
+        REQUIRE(std::all_of(visits.begin(), visits.end(), [](auto& value) { return value == 1; }));
+    };
+
+    SECTION("Automatic grain size") {
+        for (auto count : { 0u, 1u, 7u, 1000u, 100000u }) {
+            test(count, 0);
+        }
+    }
+
+    SECTION("Explicit grain size") {
+        for (auto grainSize : { 1u, 3u, 64u, 1000u, 5000u }) {
+            test(10000, grainSize);
+        }
+    }
+
+    SECTION("Signed ranges") {
+        std::atomic<int64_t> sum { 0 };
+        auto task = tasks::parallel_for(-1000, 1001, [&sum](int i) {
+            sum += i + 1000;
+        });
+
+        tasks::wait(task);
+        REQUIRE(sum == 2000 * 2001 / 2);
+
+        task = tasks::parallel_for(10, 5, [&sum](int) {
+            sum = -1;
+        });
+
+        tasks::wait(task);
+        REQUIRE(sum == 2000 * 2001 / 2);
+    }
+
+    SECTION("Nested loops") {
+        static constexpr size_t SIZE = 300;
+
+        std::vector<std::atomic<uint32_t>> visits(SIZE * SIZE);
+        auto task = tasks::add([&visits](auto& task) {
+            for (auto row = 0u; row < SIZE; row++) {
+                tasks::parallel_for(task, 0u, SIZE, [&visits, row](size_t column) {
+                    ++visits[row * SIZE + column];
+                });
+            }
+        });
+
+        tasks::wait(task);
+        REQUIRE(std::all_of(visits.begin(), visits.end(), [](auto& value) { return value == 1; }));
+    }
+
+    tasks::shutdown();
+}
+
+TEST_CASE("SIMD kernels", "[tasks]") {
+    auto test = [](auto value) {
+        using T = decltype(value);
+
+        for (auto count : { 0u, 1u, 3u, 7u, 8u, 17u, 33u, 100u, 1001u }) {
+            std::vector<T> input(count);
+            for (auto i = 0u; i < count; i++) {
+                input[i] = (T)(i % 13 + 1);
+            }
+
+            T sum = 5;
+            std::vector<T> expected(count);
+            for (auto i = 0u; i < count; i++) {
+                sum += input[i];
+                expected[i] = sum;
+            }
+
+            REQUIRE(SimdKernels::sum(input.data(), count, (T)5) == sum);
+
+            std::vector<T> output(count);
+            REQUIRE(SimdKernels::inclusiveScan(input.data(), output.data(), count, (T)5) == sum);
+            REQUIRE(output == expected);
+
+            SimdKernels::inclusiveScan(input.data(), input.data(), count, (T)5);
+            REQUIRE(input == expected);
+        }
+    };
+
+    // Small integers sum to the same value in any order, also as floating point values.
+    test(0.0f);
+    test(0.0);
+    test(int32_t(0));
+    test(uint32_t(0));
+    test(int64_t(0));
+    test(uint64_t(0));
+}
+
+TEST_CASE("Parallel reduce and scan", "[tasks]") {
+    tasks::init(std::max(4u, std::thread::hardware_concurrency()));
+
+    SECTION("Sums") {
+        for (auto count : { 0u, 1u, 1000u, 100000u }) {
+            std::vector<int64_t> values(count);
+            std::iota(values.begin(), values.end(), int64_t(1));
+
+            auto future = tasks::parallel_reduce(values.begin(), values.end(), int64_t(0));
+            tasks::wait(future);
+            REQUIRE(future.get() == (int64_t)count * (count + 1) / 2);
+
+            auto grainFuture = tasks::parallel_reduce(values.data(), values.data() + count, int64_t(0),
+                std::plus<int64_t>(), 7);
+            tasks::wait(grainFuture);
+            REQUIRE(grainFuture.get() == (int64_t)count * (count + 1) / 2);
+        }
+    }
+
+    SECTION("Non-commutative operations") {
+        std::vector<std::string> words(5000);
+        std::string expected;
+        for (auto i = 0u; i < words.size(); i++) {
+            words[i] = std::to_string(i) + ",";
+            expected += words[i];
+        }
+
+        auto future = tasks::parallel_reduce(words.begin(), words.end(), std::string(), std::plus<>(), 16);
+        tasks::wait(future);
+        REQUIRE(future.get() == expected);
+    }
+
+    SECTION("Custom operations") {
+        std::vector<int32_t> values(20000);
+        for (auto i = 0u; i < values.size(); i++) {
+            values[i] = (int32_t)((i * 7919) % 10007);
+        }
+
+        auto future = tasks::parallel_reduce(values.begin(), values.end(), INT32_MIN, [](int32_t a, int32_t b) {
+            return std::max(a, b);
+        });
+        tasks::wait(future);
+        REQUIRE(future.get() == *std::max_element(values.begin(), values.end()));
+    }
+
+    SECTION("Scans") {
+        for (auto count : { 0u, 1u, 1000u, 4097u, 100000u }) {
+            std::vector<uint32_t> values(count);
+            for (auto i = 0u; i < count; i++) {
+                values[i] = i % 17;
+            }
+
+            std::vector<uint32_t> expected(count);
+            std::inclusive_scan(values.begin(), values.end(), expected.begin());
+
+            std::vector<uint32_t> output(count);
+            auto task = tasks::parallel_scan(values.begin(), values.end(), output.begin());
+            tasks::wait(task);
+            REQUIRE(output == expected);
+
+            task = tasks::parallel_scan(values.data(), values.data() + count, values.data());
+            tasks::wait(task);
+            REQUIRE(values == expected);
+        }
+    }
+
+    SECTION("Non-commutative scans") {
+        // Composition of affine functions `x * first + second`, with wrapping arithmetic.
+        using Affine = std::pair<uint32_t, uint32_t>;
+        auto compose = [](const Affine& a, const Affine& b) {
+            return Affine { a.first * b.first, a.second * b.first + b.second };
+        };
+
+        std::vector<Affine> values(20000);
+        for (auto i = 0u; i < values.size(); i++) {
+            values[i] = { i % 5 + 1, i % 11 };
+        }
+
+        std::vector<Affine> expected(values.size());
+        std::inclusive_scan(values.begin(), values.end(), expected.begin(), compose);
+
+        std::vector<Affine> output(values.size());
+        auto task = tasks::parallel_scan(values.begin(), values.end(), output.begin(), compose);
+        tasks::wait(task);
+        REQUIRE(output == expected);
+    }
+
+    tasks::shutdown();
+}
+
+TEST_CASE("Parallel sort", "[tasks]") {
+    tasks::init(std::max(4u, std::thread::hardware_concurrency()));
+
+    auto randomValues = [](auto value, size_t count) {
+        using T = decltype(value);
+
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        std::vector<T> values(count);
+        for (auto& v : values) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            v = (T)(state >> 16);
+        }
+
+        return values;
+    };
+
+    SECTION("Merge sort") {
+        for (auto count : { 0u, 1u, 100u, 4097u, 100000u, 300001u }) {
+            auto values = randomValues(int32_t(0), count);
+            auto expected = values;
+            std::sort(expected.begin(), expected.end());
+
+            auto task = tasks::parallel_sort(values.begin(), values.end());
+            tasks::wait(task);
+            REQUIRE(values == expected);
+        }
+    }
+
+    SECTION("Custom comparisons") {
+        auto keys = randomValues(uint16_t(0), 200000);
+        std::vector<std::string> values(keys.size());
+        std::transform(keys.begin(), keys.end(), values.begin(), [](auto key) { return std::to_string(key); });
+
+        auto expected = values;
+        std::sort(expected.begin(), expected.end(), std::greater<>());
+
+        auto task = tasks::parallel_sort(values.begin(), values.end(), std::greater<>());
+        tasks::wait(task);
+        REQUIRE(values == expected);
+    }
+
+    SECTION("Radix sort") {
+        auto test = [&](auto value) {
+            for (auto count : { 0u, 1u, 1000u, 65537u, 300001u }) {
+                auto values = randomValues(value, count);
+                auto expected = values;
+                std::sort(expected.begin(), expected.end());
+
+                auto task = tasks::parallel_radix_sort(values.begin(), values.end());
+                tasks::wait(task);
+                REQUIRE(values == expected);
+            }
+        };
+
+        test(uint8_t(0));
+        test(int16_t(0));
+        test(int32_t(0));
+        test(uint32_t(0));
+        test(int64_t(0));
+        test(uint64_t(0));
+
+        // Only the lowest digit differs, the others are skipped.
+        std::vector<uint64_t> values(100000);
+        for (auto i = 0u; i < values.size(); i++) {
+            values[i] = (values.size() - i) % 256;
+        }
+
+        auto task = tasks::parallel_radix_sort(values.data(), values.data() + values.size());
+        tasks::wait(task);
+        REQUIRE(std::is_sorted(values.begin(), values.end()));
+    }
+
+    tasks::shutdown();
+}
+
+TEST_CASE("Pipelines", "[tasks]") {
+    tasks::init(std::max(4u, std::thread::hardware_concurrency()));
+
+    static constexpr uint32_t ITEM_COUNT = 10000;
+    static constexpr size_t TOKEN_COUNT = 8;
+
+    SECTION("Stage modes") {
+        uint32_t produced = 0;
+        std::atomic<uint32_t> inFlight { 0 };
+        std::atomic<uint32_t> maxInFlight { 0 };
+        // Runs of each serial stage, which must not overlap.
+        std::atomic<uint32_t> unorderedRunning { 0 };
+        std::atomic<uint32_t> orderedRunning { 0 };
+        std::atomic<bool> overlapped { false };
+        std::vector<uint32_t> unordered;
+        std::vector<uint64_t> ordered;
+
+        auto enterSerial = [&](std::atomic<uint32_t>& running) {
+            if (running++ != 0) {
+                overlapped = true;
+            }
+        };
+
+        auto task = tasks::pipeline(TOKEN_COUNT, [&](tasks::FlowControl& flow) {
+            if (produced == ITEM_COUNT) {
+                flow.stop();
+                return 0u;
+            }
+
+            auto count = ++inFlight;
+            auto max = maxInFlight.load();
+            while (count > max && !maxInFlight.compare_exchange_weak(max, count)) { }
+            return produced++;
+        }, tasks::stage(tasks::StageMode::Parallel, [](uint32_t i) {
+            return std::make_unique<uint64_t>((uint64_t)i * i);
+        }), tasks::stage(tasks::StageMode::SerialOutOfOrder, [&](std::unique_ptr<uint64_t> square) {
+            enterSerial(unorderedRunning);
+            unordered.push_back((uint32_t)std::sqrt((double)*square));
+            unorderedRunning--;
+            return square;
+        }), tasks::stage(tasks::StageMode::SerialInOrder, [&](std::unique_ptr<uint64_t> square) {
+            enterSerial(orderedRunning);
+            ordered.push_back(*square);
+            orderedRunning--;
+            inFlight--;
+        }));
+
+        tasks::wait(task);
+
+        REQUIRE(maxInFlight <= TOKEN_COUNT);
+        REQUIRE(!overlapped);
+        REQUIRE(ordered.size() == ITEM_COUNT);
+        for (auto i = 0u; i < ITEM_COUNT; i++) {
+            REQUIRE(ordered[i] == (uint64_t)i * i);
+        }
+
+        std::sort(unordered.begin(), unordered.end());
+        for (auto i = 0u; i < ITEM_COUNT; i++) {
+            REQUIRE(unordered[i] == i);
+        }
+    }
+
+    SECTION("Empty input") {
+        std::atomic<uint32_t> runs { 0 };
+        auto task = tasks::pipeline(TOKEN_COUNT, [](tasks::FlowControl& flow) {
+            flow.stop();
+            return 0;
+        }, tasks::stage(tasks::StageMode::SerialInOrder, [&](int) {
+            runs++;
+        }));
+
+        tasks::wait(task);
+        REQUIRE(runs == 0);
+    }
+
+    SECTION("Single token") {
+        uint32_t produced = 0;
+        std::vector<uint32_t> ordered;
+        auto task = tasks::pipeline(1, [&](tasks::FlowControl& flow) {
+            if (produced == 100) {
+                flow.stop();
+            }
+
+            return produced++;
+        }, tasks::stage(tasks::StageMode::Parallel, [](uint32_t i) {
+            return i + 1;
+        }), tasks::stage(tasks::StageMode::SerialOutOfOrder, [&](uint32_t i) {
+            ordered.push_back(i);
+        }));
+
+        tasks::wait(task);
+        REQUIRE(ordered.size() == 100);
+        REQUIRE(std::is_sorted(ordered.begin(), ordered.end()));
+    }
+
+    tasks::shutdown();
+}
+
+static int parallelFib(int n) {
+    if (n < 2) {
+        return n;
+    }
+
+    auto future = tasks::async([n](auto&) {
+        return parallelFib(n - 1);
+    });
+
+    auto b = parallelFib(n - 2);
+    tasks::wait(future);
+    return future.get() + b;
+}
+
+// Waits on a chain of `depth` nested tasks, each of which also adds an unrelated subtask of `root` above its
+// child in the worker's queue.
+static void nestedWait(Task& root, uint32_t depth, std::atomic<uint32_t>& levels, std::atomic<uint32_t>& unrelated) {
+    ++levels;
+    if (depth == 0) {
+        return;
+    }
+
+    auto child = tasks::create([&root, depth, &levels, &unrelated](auto&) {
+        nestedWait(root, depth - 1, levels, unrelated);
+    });
+
+    child->submit();
+    tasks::add(root, [&unrelated](auto&) {
+        ++unrelated;
+    });
+
+    tasks::wait(child);
+}
+
+// Waits `depth` levels deep on a task with `unrelatedCount` unrelated subtasks of `root` above it in the worker's
+// queue, or on a task depending on them.
+static void waitBehindUnrelated(Task& root, uint32_t depth, uint32_t unrelatedCount, bool dependent,
+    std::atomic<uint32_t>& ran) {
+    if (depth > 0) {
+        auto task = tasks::add([&root, depth, unrelatedCount, dependent, &ran](auto&) {
+            waitBehindUnrelated(root, depth - 1, unrelatedCount, dependent, ran);
+        });
+
+        tasks::wait(task);
+        return;
+    }
+
+    auto waited = tasks::create([&ran](auto&) {
+        ++ran;
+    });
+
+    if (!dependent) {
+        waited->submit();
+    }
+
+    for (auto i = 0u; i < unrelatedCount; i++) {
+        auto unrelated = tasks::add(root, [&ran](auto&) {
+            ++ran;
+        });
+
+        if (dependent) {
+            Task::precede(unrelated, *waited);
+        }
+    }
+
+    if (dependent) {
+        waited->submit();
+    }
+
+    tasks::wait(waited);
+}
+
+// Waits for `task`, and records the largest number of these waits nested on a single thread in `maxDepth`.
+static void waitCountingDepth(tasks::TaskHandle& task, std::atomic<uint32_t>& maxDepth) {
+    static thread_local uint32_t depth = 0;
+
+    depth++;
+    auto observed = maxDepth.load();
+    while (observed < depth && !maxDepth.compare_exchange_weak(observed, depth)) { }
+
+    tasks::wait(task);
+    depth--;
+}
+
+TEST_CASE("Nested waits", "[tasks]") {
+    SECTION("Recursive fork/join") {
+        tasks::init(std::max(4u, std::thread::hardware_concurrency()));
+
+        std::atomic<int> result { 0 };
+        auto task = tasks::add([&result](auto&) {
+            result = parallelFib(20);
+        });
+
+        tasks::wait(task);
+        REQUIRE(result == 6765);
+        REQUIRE(parallelFib(15) == 610);
+
+        tasks::shutdown();
+    }
+
+    SECTION("Waiting on tasks with dependencies from background workers") {
+        tasks::init(std::max(4u, std::thread::hardware_concurrency()));
+
+        std::atomic<int> count { 0 };
+        std::vector<tasks::TaskHandle> waiters;
+        for (auto i = 0u; i < 16u; i++) {
+            waiters.push_back(tasks::add([&count](auto&) {
+                auto first = tasks::create([&count](auto&) {
+                    ++count;
+                });
+
+                auto second = tasks::after({ first }, [&count](auto&) {
+                    ++count;
+                });
+
+                first->submit();
+                tasks::wait(second);
+                ++count;
+            }));
+        }
+
+        for (auto& waiter : waiters) {
+            tasks::wait(waiter);
+        }
+
+        REQUIRE(count == 48);
+
+        tasks::shutdown();
+    }
+
+    SECTION("Waits deeper than the bound") {
+        auto threadCount = GENERATE(1u, 4u);
+        tasks::init(threadCount);
+
+        std::atomic<uint32_t> levels { 0 };
+        std::atomic<uint32_t> unrelated { 0 };
+        auto depth = Worker::MAX_WAIT_DEPTH * 4;
+        auto task = tasks::add([depth, &levels, &unrelated](auto& root) {
+            nestedWait(root, depth, levels, unrelated);
+        });
+
+        tasks::wait(task);
+        REQUIRE(levels == depth + 1);
+        REQUIRE(unrelated == depth);
+
+        tasks::shutdown();
+    }
+
+    SECTION("Waits deeper than the bound behind many unrelated tasks") {
+        static constexpr uint32_t UNRELATED_COUNT = 1000;
+
+        // A single worker has to find the waited task below the unrelated ones, or run the unrelated tasks it
+        // depends on itself.
+        auto threadCount = GENERATE(1u, 4u);
+        auto dependent = GENERATE(false, true);
+        tasks::init(threadCount);
+
+        std::atomic<uint32_t> ran { 0 };
+        auto root = tasks::add([&ran, dependent](auto& task) {
+            waitBehindUnrelated(task, Worker::MAX_WAIT_DEPTH + 2, UNRELATED_COUNT, dependent, ran);
+        });
+
+        tasks::wait(root);
+        REQUIRE(ran == UNRELATED_COUNT + 1);
+
+        tasks::shutdown();
+    }
+
+    SECTION("Waits deeper than the bound don't start other waits") {
+        static constexpr uint32_t WAITER_COUNT = Worker::MAX_WAIT_DEPTH * 4;
+
+        // Every waiter waits for a task held back by the gate, so waiting workers have nothing to run but other
+        // waiters until the gate is submitted.
+        auto threadCount = GENERATE(1u, 4u);
+        tasks::init(threadCount);
+
+        std::atomic<uint32_t> maxDepth { 0 };
+        std::atomic<uint32_t> ran { 0 };
+        auto gate = tasks::create([](auto&) { });
+
+        std::vector<tasks::TaskHandle> waiters;
+        for (auto i = 0u; i < WAITER_COUNT; i++) {
+            waiters.push_back(tasks::add([&gate, &maxDepth, &ran](auto&) {
+                auto waited = tasks::create([&ran](auto&) {
+                    ++ran;
+                });
+
+                Task::precede(gate, *waited);
+                waited->submit();
+                waitCountingDepth(waited, maxDepth);
+            }));
+        }
+
+        // Submitted from a thread which isn't a worker, as every worker may be waiting.
+        std::thread opener([gate]() mutable {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            gate->submit();
+        });
+
+        for (auto& waiter : waiters) {
+            tasks::wait(waiter);
+        }
+
+        opener.join();
+        REQUIRE(ran == WAITER_COUNT);
+        REQUIRE(maxDepth <= Worker::MAX_WAIT_DEPTH + 1);
+
+        tasks::shutdown();
+    }
+}
+
+#ifdef TASKGRAPH_HAS_COROUTINES
+namespace {
+    tasks::co_task<int> square(int value) {
+        auto future = tasks::async([value](auto&) {
+            return value * value;
+        });
+
+        co_return co_await future;
+    }
+
+    tasks::co_task<int> sumOfSquares(int count, std::atomic<int>& sideEffects) {
+        int sum = 0;
+        for (auto i = 1; i <= count; i++) {
+            auto task = tasks::add([&sideEffects](auto& task) {
+                tasks::add(task, [&sideEffects](auto&) {
+                    ++sideEffects;
+                });
+            });
+
+            // Resumed once the task and its subtask have finished.
+            co_await task;
+            if (sideEffects != i) {
+                co_return -1;
+            }
+
+            sum += co_await square(i);
+        }
+
+        co_return sum;
+    }
+
+    tasks::co_task<> countDown(std::atomic<int>& counter) {
+        while (counter > 0) {
+            co_await tasks::add([&counter](auto&) {
+                --counter;
+            });
+        }
+    }
+
+    tasks::co_task<> awaitEmptyTasks(int count, std::atomic<int>& awaited) {
+        for (auto i = 0; i < count; i++) {
+            co_await tasks::add([](auto&) { });
+            ++awaited;
+        }
+    }
+}
+
+TEST_CASE("Coroutine tasks", "[tasks]") {
+    tasks::init(std::max(4u, std::thread::hardware_concurrency()));
+
+    SECTION("Awaiting tasks, futures and coroutines") {
+        std::atomic<int> sideEffects { 0 };
+        auto future = tasks::async(sumOfSquares(20, sideEffects));
+        tasks::wait(future);
+        REQUIRE(future.get() == 20 * 21 * 41 / 6);
+        REQUIRE(sideEffects == 20);
+    }
+
+    SECTION("Many coroutines") {
+        std::vector<std::atomic<int>> counters(100);
+        std::vector<TaskFuture<void>> futures;
+        for (auto& counter : counters) {
+            counter = 50;
+            futures.push_back(tasks::async(countDown(counter)));
+        }
+
+        for (auto& future : futures) {
+            tasks::wait(future);
+        }
+
+        REQUIRE(std::all_of(counters.begin(), counters.end(), [](auto& counter) { return counter == 0; }));
+    }
+
+    SECTION("Awaiting tasks which are just finishing") {
+        static constexpr int COROUTINE_COUNT = 8;
+        static constexpr int AWAIT_COUNT = 5000;
+
+        // Empty tasks are stolen and finished by other workers while the coroutines suspend, and their slots
+        // are reused right away.
+        std::atomic<int> awaited { 0 };
+        std::vector<TaskFuture<void>> futures;
+        for (auto i = 0; i < COROUTINE_COUNT; i++) {
+            futures.push_back(tasks::async(awaitEmptyTasks(AWAIT_COUNT, awaited)));
+        }
+
+        for (auto& future : futures) {
+            tasks::wait(future);
+        }
+
+        REQUIRE(awaited == COROUTINE_COUNT * AWAIT_COUNT);
+    }
+
+    SECTION("Unstarted coroutines") {
+        std::atomic<int> sideEffects { 0 };
+        {
+            auto coTask = sumOfSquares(3, sideEffects);
+        }
+
+        REQUIRE(sideEffects == 0);
+    }
+
+    tasks::shutdown();
+}
+#endif